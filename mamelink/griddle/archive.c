@@ -0,0 +1,339 @@
+/*
+	Region archives.
+
+	griddle -a writes every region of an indirect build into one archive
+	file, and fred can load any region out of it by name or global ID
+	without going near the parser.  The file is meant to be mapped and
+	used in place; every number in it is four bytes, most significant
+	first:
+
+		header		"GRA1", class table hash (as in a binary raw
+				file), region count, bucket count
+		name buckets	entry number + 1 for each bucket, 0 if empty
+		ID buckets	the same, hashed on the region's global ID
+		entries		name offset, global ID, data offset, data
+				length for each region
+		names		NUL terminated
+		data		each region's objects as binary raw records
+
+	Both directories are open hash tables with linear probing.  Offsets
+	are from the start of the file.  A region's name is its template
+	name followed by its arguments from the indirect file, separated by
+	spaces: 'street Main St 20'.
+ */
+
+#include "griddleDefs.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define ARCHIVE_MAGIC	"GRA1"
+#define ARCHIVE_HEADER	16
+#define ARCHIVE_ENTRY	16
+
+typedef struct archiveEntryStruct {
+	char	*name;
+	int	 id;
+	int	 dataOffset;
+	int	 dataLength;
+} archiveEntry;
+
+  void
+openArchive()
+{
+	gx->archiveEntries = NULL;
+	gx->archiveCount = 0;
+	gx->archiveData = open_memstream(&gx->archiveDataBuffer,
+		&gx->archiveDataSize);
+}
+
+/*
+	Called in pass 2 before region 'reg' is parsed, while indirName and
+	indirArgv still describe its line of the indirect file.
+ */
+  void
+beginArchiveRegion(reg)
+  int	reg;
+{
+	archiveEntry	*entry;
+	int		 length;
+	int		 i;
+
+	if ((gx->archiveCount & 63) == 0)
+		gx->archiveEntries = (archiveEntry *)realloc(
+			gx->archiveEntries,
+			(gx->archiveCount + 64) * sizeof(archiveEntry));
+	entry = &gx->archiveEntries[gx->archiveCount++];
+	length = strlen(gx->indirName) + 1;
+	for (i=0; i<gx->indirArgc; ++i)
+		length += strlen(gx->indirArgv[i]) + 1;
+	entry->name = malloc(length);
+	strcpy(entry->name, gx->indirName);
+	if ((length = strlen(entry->name)) > 4 &&
+			strcmp(entry->name + length - 4, ".gri") == 0)
+		entry->name[length - 4] = '\0';
+	for (i=0; i<gx->indirArgc; ++i) {
+		strcat(entry->name, " ");
+		strcat(entry->name, gx->indirArgv[i]);
+	}
+	entry->id = gx->indirTable[reg].region;
+	entry->dataOffset = ftell(gx->archiveData);
+}
+
+  void
+archiveObject(obj)
+  object	*obj;
+{
+	int		length;
+	profilePhase	phase;
+
+	phase = PROFILE_ENTER(PHASE_OUTPUT);
+	length = formatRawObject(obj, TRUE);
+	fwrite(gx->rawRecord, 1, length, gx->archiveData);
+	PROFILE_LEAVE(phase);
+}
+
+  void
+endArchiveRegion()
+{
+	archiveEntry	*entry;
+
+	entry = &gx->archiveEntries[gx->archiveCount - 1];
+	entry->dataLength = ftell(gx->archiveData) - entry->dataOffset;
+}
+
+  static void
+insertBucket(buckets, bucketCount, hash, n)
+  byte		*buckets;
+  int		 bucketCount;
+  unsigned long	 hash;
+  int		 n;
+{
+	int	i;
+
+	for (i = hash & (bucketCount - 1); getLong(buckets, 4*i) != 0;
+			i = (i + 1) & (bucketCount - 1))
+		;
+	fillLong(buckets, 4*i, n + 1);
+}
+
+/*
+	Lay out the directory in front of the region data collected during
+	the build and write the lot out.
+ */
+  void
+closeArchive()
+{
+	byte		*directory;
+	byte		*entryOut;
+	byte		 header[BINARY_RAW_HEADER];
+	int		 bucketCount;
+	int		 directorySize;
+	int		 nameOffset;
+	int		 i, j;
+	char		*newName;
+	FILE		*fyle;
+
+	fclose(gx->archiveData);
+	gx->archiveData = NULL;
+	for (bucketCount = 1; bucketCount < 2*gx->archiveCount; )
+		bucketCount <<= 1;
+	directorySize = ARCHIVE_HEADER + 8*bucketCount +
+		ARCHIVE_ENTRY*gx->archiveCount;
+	nameOffset = directorySize;
+	for (i=0; i<gx->archiveCount; ++i)
+		directorySize += strlen(gx->archiveEntries[i].name) + 1;
+
+	directory = (byte *)calloc(1, directorySize);
+	binaryRawHeader(header);
+	memcpy(directory, ARCHIVE_MAGIC, 4);
+	memcpy(directory + 4, header + 4, 4);
+	fillLong(directory, 8, gx->archiveCount);
+	fillLong(directory, 12, bucketCount);
+	entryOut = directory + ARCHIVE_HEADER + 8*bucketCount;
+	for (i=0; i<gx->archiveCount; ++i) {
+		for (j=0; j<i; ++j)
+			if (strcmp(gx->archiveEntries[j].name,
+					gx->archiveEntries[i].name) == 0)
+				break;
+		if (j < i)
+			error("region name '%s' used twice in archive\n",
+				gx->archiveEntries[i].name);
+		else
+			insertBucket(directory + ARCHIVE_HEADER, bucketCount,
+				hashString(HASH_START,
+					gx->archiveEntries[i].name), i);
+		insertBucket(directory + ARCHIVE_HEADER + 4*bucketCount,
+			bucketCount,
+			hashInt(HASH_START, gx->archiveEntries[i].id), i);
+		fillLong(entryOut, 0, nameOffset);
+		fillLong(entryOut, 4, gx->archiveEntries[i].id);
+		fillLong(entryOut, 8, directorySize +
+			gx->archiveEntries[i].dataOffset);
+		fillLong(entryOut, 12, gx->archiveEntries[i].dataLength);
+		entryOut += ARCHIVE_ENTRY;
+		strcpy((char *)directory + nameOffset,
+			gx->archiveEntries[i].name);
+		nameOffset += strlen(gx->archiveEntries[i].name) + 1;
+		free(gx->archiveEntries[i].name);
+	}
+
+	newName = malloc(strlen(gx->archiveName) + 5);
+	sprintf(newName, "%s.new", gx->archiveName);
+	if ((fyle = fopen(newName, "w")) == NULL)
+		systemError("can't open archive file %s\n", newName);
+	fwrite(directory, 1, directorySize, fyle);
+	fwrite(gx->archiveDataBuffer, 1, gx->archiveDataSize, fyle);
+	if (fclose(fyle) != 0)
+		systemError("can't write archive file %s\n", newName);
+	if (rename(newName, gx->archiveName) != 0)
+		systemError("can't replace archive file %s\n", gx->archiveName);
+	free(newName);
+	free(directory);
+	free(gx->archiveDataBuffer);
+	free(gx->archiveEntries);
+	gx->archiveEntries = NULL;
+}
+
+/*
+	Map archive 'name', keeping the last one mapped for as long as the
+	file stays the same.
+ */
+  static byte *
+mapArchive(name, lengthptr)
+  char	*name;
+  int	*lengthptr;
+{
+	struct stat	 st;
+	int		 fd;
+	void		*map;
+
+	if ((fd = open(name, O_RDONLY)) < 0)
+		return(NULL);
+	if (fstat(fd, &st) != 0 || st.st_size < ARCHIVE_HEADER) {
+		close(fd);
+		return(NULL);
+	}
+	if (gx->archiveMap != NULL && strcmp(gx->archiveMapName, name) == 0
+			&& gx->archiveMapLength == st.st_size
+			&& gx->archiveMapTime == st.st_mtime) {
+		close(fd);
+		*lengthptr = gx->archiveMapLength;
+		return(gx->archiveMap);
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return(NULL);
+	if (gx->archiveMap != NULL) {
+		munmap(gx->archiveMap, gx->archiveMapLength);
+		free(gx->archiveMapName);
+	}
+	gx->archiveMap = (byte *)map;
+	gx->archiveMapLength = st.st_size;
+	gx->archiveMapTime = st.st_mtime;
+	gx->archiveMapName = saveString(name);
+	*lengthptr = gx->archiveMapLength;
+	return(gx->archiveMap);
+}
+
+  static byte *
+probeArchive(map, bucketCount, buckets, hash, key, id)
+  byte		*map;
+  int		 bucketCount;
+  byte		*buckets;
+  unsigned long	 hash;
+  char		*key;
+  int		 id;
+{
+	byte	*entry;
+	int	 i;
+	int	 n;
+
+	for (i = hash & (bucketCount - 1); (n = getLong(buckets, 4*i)) != 0;
+			i = (i + 1) & (bucketCount - 1)) {
+		entry = map + ARCHIVE_HEADER + 8*bucketCount +
+			ARCHIVE_ENTRY*(n - 1);
+		if (key != NULL ? strcmp((char *)map + getLong(entry, 0),
+				key) == 0 : getLong(entry, 4) == id)
+			return(entry);
+	}
+	return(NULL);
+}
+
+/*
+	Look up region 'key' -- a global ID if it is a number, otherwise a
+	region name -- in archive 'name' and return its objects, still as
+	binary raw records, through dataptr and lengthptr.
+ */
+  boolean
+findArchiveRegion(name, key, dataptr, lengthptr)
+  char	 *name;
+  char	 *key;
+  byte	**dataptr;
+  int	 *lengthptr;
+{
+	byte	*map;
+	byte	*entry;
+	byte	 header[BINARY_RAW_HEADER];
+	int	 length;
+	int	 count;
+	int	 bucketCount;
+	int	 id;
+	char	*end;
+
+	if ((map = mapArchive(name, &length)) == NULL)
+		return(FALSE);
+	count = getLong(map, 8);
+	bucketCount = getLong(map, 12);
+	binaryRawHeader(header);
+	if (memcmp(map, ARCHIVE_MAGIC, 4) != 0 || count < 0 ||
+			bucketCount <= 0 ||
+			(bucketCount & (bucketCount - 1)) != 0 ||
+			ARCHIVE_HEADER + 8*bucketCount + ARCHIVE_ENTRY*count >
+			length) {
+		error("%s is not a region archive\n", name);
+		return(FALSE);
+	}
+	if (memcmp(map + 4, header + 4, 4) != 0)
+		error("%s was made with other defines\n", name);
+	id = strtol(key, &end, 10);
+	if (*key == '\0' || *end != '\0')
+		entry = probeArchive(map, bucketCount, map + ARCHIVE_HEADER,
+			hashString(HASH_START, key), key, 0);
+	else if ((entry = probeArchive(map, bucketCount,
+			map + ARCHIVE_HEADER + 4*bucketCount,
+			hashInt(HASH_START, id), NULL, id)) == NULL)
+		entry = probeArchive(map, bucketCount,
+			map + ARCHIVE_HEADER + 4*bucketCount,
+			hashInt(HASH_START, -id), NULL, -id);
+	if (entry == NULL)
+		return(FALSE);
+	if (getLong(entry, 8) < 0 || getLong(entry, 12) < 0 ||
+			getLong(entry, 8) + getLong(entry, 12) > length) {
+		error("%s is damaged\n", name);
+		return(FALSE);
+	}
+	*dataptr = map + getLong(entry, 8);
+	*lengthptr = getLong(entry, 12);
+	return(TRUE);
+}
+
+/*
+	Add the objects of a region found by findArchiveRegion() to the
+	noid array, just as parsing them as raw lines would.
+ */
+  void
+loadArchiveRegion(data, length)
+  byte	*data;
+  int	 length;
+{
+	object	*obj;
+	byte	*p;
+
+	gx->currentFileName = gx->archiveMapName;
+	p = data;
+	while ((obj = decodeBinaryRecord(&p, data + length, data)) != NULL)
+		executeRawline(obj);
+}
@@ -0,0 +1,266 @@
+/*
+	Autosave.
+
+	While a region is being edited fred keeps a copy of it in the binary
+	raw file '<region file>.fredsave', which can be read back with 'r'
+	like any other region file after a crash.  Once the region has
+	changed and AUTOSAVE_INTERVAL seconds (or $FREDAUTOSAVE; 0 turns
+	autosave off) have gone by since the last autosave, the region is
+	formatted into memory as a snapshot, which takes no longer than the
+	journal's compare, and handed to a writer thread.  That is checked
+	after every command and, while fred waits for the next one, every
+	LINK_STATUS_INTERVAL (see commandgetch()), so an edit followed by a
+	long idle spell is not left unsaved.  The writer puts the snapshot in
+	'<sidecar>.new', syncs it and renames it over the sidecar, so a crash
+	leaves either the old sidecar or the new one, never half of one.  If
+	snapshots come faster than they can be written only the newest is
+	kept.
+
+	Saving the region for real removes the sidecar.  Reading another
+	region or quitting first autosaves whatever hasn't been, so the
+	sidecar is still there if the edits were never saved.  Loading a
+	region whose sidecar is newer than it says so.  Only fred's main
+	thread calls in here.
+ */
+
+#include "griddleDefs.h"
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define AUTOSAVE_INTERVAL	30
+#define SIDECAR_SUFFIX		".fredsave"
+
+typedef struct {
+	char	*sidecar;
+	char	*data;		/* NULL to remove the sidecar */
+	size_t	 length;
+} snapshot;
+
+static pthread_t	 writer;
+static pthread_mutex_t	 writerLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	 writerWanted = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t	 writerDone = PTHREAD_COND_INITIALIZER;
+static boolean		 writerRunning = FALSE;
+static boolean		 writerBusy = FALSE;
+static snapshot		*pending = NULL;
+static char		*sidecar = NULL;
+static long		 savedVersion;
+static time_t		 lastSave;
+static int		 interval = -1;
+
+  static void
+freeSnapshot(snap)
+  snapshot	*snap;
+{
+	free(snap->sidecar);
+	if (snap->data != NULL)
+		free(snap->data);
+	free(snap);
+}
+
+  static void
+writeSnapshot(snap)
+  snapshot	*snap;
+{
+	char	*newName;
+	FILE	*fyle;
+	boolean	 ok;
+
+	if (snap->data == NULL) {
+		unlink(snap->sidecar);
+		return;
+	}
+	newName = (char *)malloc(strlen(snap->sidecar) + 5);
+	sprintf(newName, "%s.new", snap->sidecar);
+	if ((fyle = fopen(newName, "w")) == NULL) {
+		free(newName);
+		return;
+	}
+	ok = fwrite(snap->data, 1, snap->length, fyle) == snap->length;
+	ok = fflush(fyle) == 0 && ok;
+	ok = fsync(fileno(fyle)) == 0 && ok;
+	ok = fclose(fyle) == 0 && ok;
+	if (!ok || rename(newName, snap->sidecar) != 0)
+		unlink(newName);
+	free(newName);
+}
+
+  static void *
+autosaveWriter(arg)
+  void	*arg;
+{
+	snapshot	*snap;
+
+	pthread_mutex_lock(&writerLock);
+	for (;;) {
+		while (pending == NULL)
+			pthread_cond_wait(&writerWanted, &writerLock);
+		snap = pending;
+		pending = NULL;
+		writerBusy = TRUE;
+		pthread_mutex_unlock(&writerLock);
+		writeSnapshot(snap);
+		freeSnapshot(snap);
+		pthread_mutex_lock(&writerLock);
+		writerBusy = FALSE;
+		pthread_cond_broadcast(&writerDone);
+	}
+	return(NULL);
+}
+
+/*
+	Give 'snap' to the writer, in place of any it hasn't started on.
+	Without a writer thread it is written here and now.
+ */
+  static void
+queueSnapshot(snap)
+  snapshot	*snap;
+{
+	if (!writerRunning && pthread_create(&writer, NULL, autosaveWriter,
+			NULL) == 0)
+		writerRunning = TRUE;
+	if (!writerRunning) {
+		writeSnapshot(snap);
+		freeSnapshot(snap);
+		return;
+	}
+	pthread_mutex_lock(&writerLock);
+	if (pending != NULL)
+		freeSnapshot(pending);
+	pending = snap;
+	pthread_cond_signal(&writerWanted);
+	pthread_mutex_unlock(&writerLock);
+}
+
+  static snapshot *
+takeSnapshot()
+{
+	snapshot	*snap;
+	FILE		*memFyle;
+	byte		 header[BINARY_RAW_HEADER];
+	int		 length;
+	int		 i;
+
+	snap = typeAlloc(snapshot);
+	snap->sidecar = saveString(sidecar);
+	snap->data = NULL;
+	snap->length = 0;
+	if ((memFyle = open_memstream(&snap->data, &snap->length)) == NULL) {
+		freeSnapshot(snap);
+		return(NULL);
+	}
+	binaryRawHeader(header);
+	fwrite(header, 1, BINARY_RAW_HEADER, memFyle);
+	for (i=0; i<gx->objectCount; ++i) {
+		if (gx->noidArray[i] == NULL)
+			continue;
+		length = formatRawObject(gx->noidArray[i], TRUE);
+		fwrite(gx->rawRecord, 1, length, memFyle);
+	}
+	fclose(memFyle);
+	return(snap);
+}
+
+/*
+	Start autosaving the region just read from 'fileName'.
+ */
+  void
+startAutosave(fileName)
+  char	*fileName;
+{
+	char	*env;
+
+	if (interval < 0)
+		interval = (env = getenv("FREDAUTOSAVE")) != NULL ?
+			atoi(env) : AUTOSAVE_INTERVAL;
+	if (sidecar != NULL)
+		free(sidecar);
+	sidecar = (char *)malloc(strlen(fileName) + strlen(SIDECAR_SUFFIX)
+		+ 1);
+	sprintf(sidecar, "%s%s", fileName, SIDECAR_SUFFIX);
+	savedVersion = journalVersion();
+	lastSave = time(NULL);
+}
+
+/*
+	Return the name of the region's sidecar if one is left over from
+	before that is newer than the region file, or NULL.
+ */
+  char *
+newerAutosave()
+{
+	char		*fileName;
+	char		*key;
+	struct stat	 fileStat;
+	struct stat	 sidecarStat;
+	boolean		 older;
+	char		*index();
+
+	if (sidecar == NULL || stat(sidecar, &sidecarStat) != 0)
+		return(NULL);
+	fileName = saveString(sidecar);
+	fileName[strlen(fileName) - strlen(SIDECAR_SUFFIX)] = '\0';
+	if ((key = index(fileName, '#')) != NULL)
+		*key = '\0';
+	older = stat(fileName, &fileStat) == 0 &&
+		fileStat.st_mtime > sidecarStat.st_mtime;
+	free(fileName);
+	return(older ? NULL : sidecar);
+}
+
+/*
+	Called after every command and while waiting for the next: snapshot
+	the region if it has changed and it is time to, or if 'now' whatever
+	the time.
+ */
+  void
+autosave(now)
+  boolean	now;
+{
+	snapshot	*snap;
+
+	if (sidecar == NULL || interval <= 0 ||
+			journalVersion() == savedVersion)
+		return;
+	if (!now && time(NULL) - lastSave < interval)
+		return;
+	if ((snap = takeSnapshot()) == NULL)
+		return;
+	queueSnapshot(snap);
+	savedVersion = journalVersion();
+	lastSave = time(NULL);
+}
+
+/*
+	The region has been saved for real, so the sidecar can go.
+ */
+  void
+forgetAutosave()
+{
+	snapshot	*snap;
+
+	if (sidecar == NULL)
+		return;
+	snap = typeAlloc(snapshot);
+	snap->sidecar = saveString(sidecar);
+	snap->data = NULL;
+	snap->length = 0;
+	queueSnapshot(snap);
+	savedVersion = journalVersion();
+}
+
+/*
+	Write out anything not yet autosaved and wait for the writer.
+ */
+  void
+finishAutosave()
+{
+	autosave(TRUE);
+	if (!writerRunning)
+		return;
+	pthread_mutex_lock(&writerLock);
+	while (pending != NULL || writerBusy)
+		pthread_cond_wait(&writerDone, &writerLock);
+	pthread_mutex_unlock(&writerLock);
+}
@@ -1,6 +1,6 @@
 #include "griddleDefs.h"
 
-value *evaluate(expression	*expr);
+value evaluate(expression	*expr);
 
   genericListHead *
 buildGenericList(list, new)
@@ -74,41 +74,119 @@ buildStringList(list, new)
 	return((stringList *)buildGenericList(list, new));
 }
 
+/*
+	Expression nodes are carved out of blocks of EXPR_BLOCK, and the ones
+	freeExpr() hands back are kept on a free list, linked through their
+	'right' field, for the next statement to reuse.
+ */
+#define EXPR_BLOCK	256
+
+typedef struct exprBlockStruct {
+	struct exprBlockStruct	*next;
+	int			 used;
+	expression		 nodes[EXPR_BLOCK];
+} exprBlock;
+
   expression *
-buildExpr(
-  exprType	type,
-  intptr_t	arg1,
-  intptr_t	arg2,
-  intptr_t	arg3)
+newExpr(type)
+  exprType	type;
 {
 	expression	*result;
+	exprBlock	*block;
 
-	result = typeAlloc(expression);
+	if ((result = gx->freeExprs) != NULL)
+		gx->freeExprs = result->right;
+	else {
+		block = gx->exprBlocks;
+		if (block == NULL || block->used == EXPR_BLOCK) {
+			block = typeAlloc(exprBlock);
+			block->used = 0;
+			block->next = gx->exprBlocks;
+			gx->exprBlocks = block;
+		}
+		result = &block->nodes[block->used++];
+	}
 	result->type = type;
-	result->part1 = arg1;
-	result->part2 = arg2;
-	result->part3 = arg3;
-	return(result);	
+	result->oper = 0;
+	result->part.operand = NULL;
+	result->right = NULL;
+	return(result);
 }
 
-expression *
-buildExprI(exprType	type, intptr_t arg1) {
-	return buildExpr(type, arg1, 0, 0);
+  void
+freeExprPool(context)
+  griddleContext	*context;
+{
+	exprBlock	*block;
+	exprBlock	*next;
+
+	for (block = context->exprBlocks; block != NULL; block = next) {
+		next = block->next;
+		free(block);
+	}
+	context->exprBlocks = NULL;
+	context->freeExprs = NULL;
 }
 
-expression *
-buildExprP(exprType	type, void	*arg1) {
-	return buildExpr(type, (intptr_t)arg1, 0, 0);
+  expression *
+buildNameExpr(name)
+  symbol	*name;
+{
+	expression	*result;
+
+	result = newExpr(ID_EXPR);
+	result->part.name = name;
+	return(foldExpr(result));
 }
 
-expression *
-buildExprIP(exprType	type, intptr_t arg1, void	*arg2) {
-	return buildExpr(type, arg1, (intptr_t)arg2, 0);
+  expression *
+buildNumberExpr(number)
+  int	number;
+{
+	expression	*result;
+
+	result = newExpr(NUM_EXPR);
+	result->oper = VAL_INTEGER;
+	result->part.number = number;
+	return(result);
 }
 
-expression *
-buildExprPIP(exprType	type, void	*arg1, intptr_t arg2, void *arg3) {
-	return buildExpr(type, (intptr_t)arg1, arg2, (intptr_t)arg3);
+  expression *
+buildStringExpr(string)
+  char	*string;
+{
+	expression	*result;
+
+	result = newExpr(STRING_EXPR);
+	result->part.string = string;
+	return(result);
+}
+
+  expression *
+buildBitStringExpr(bitString)
+  byte	*bitString;
+{
+	expression	*result;
+
+	result = newExpr(BITSTRING_EXPR);
+	result->part.bitString = bitString;
+	return(result);
+}
+
+  expression *
+buildOperExpr(type, oper, operand, right)
+  exprType	 type;
+  int		 oper;
+  expression	*operand;
+  expression	*right;
+{
+	expression	*result;
+
+	result = newExpr(type);
+	result->oper = oper;
+	result->part.operand = operand;
+	result->right = right;
+	return(foldExpr(result));
 }
 
   property *
@@ -124,38 +202,37 @@ buildProperty(fieldName, data)
 	return(result);
 }
 
-  value *
+  value
 buildValue(vtype, val)
   valueType	vtype;
-  int		val;
+  intptr_t	val;
 {
-	value	*result;
+	value	result;
 
-	result = typeAlloc(value);
-	result->value = val;
-	result->dataType = vtype;
+	result.value = val;
+	result.dataType = vtype;
 	return(result);
 }
 
-  value *
+  value
 buildNumber(val)
   int		val;
 {
 	return(buildValue(VAL_INTEGER, val));
 }
 
-  value *
+  value
 buildString(val)
   char		*val;
 {
-	return(buildValue(VAL_STRING, (int)val));
+	return(buildValue(VAL_STRING, (intptr_t)val));
 }
 
-  value *
+  value
 buildBitString(val)
   byte		*val;
 {
-	return(buildValue(VAL_BITSTRING, (int)val));
+	return(buildValue(VAL_BITSTRING, (intptr_t)val));
 }
 
   field *
@@ -166,7 +243,7 @@ buildField(name, dimension, type, initList)
   exprList	*initList;
 {
 	field	*result;
-	value	*val;
+	value	 val;
 
 	result = typeAlloc(field);
 	result->name = name;
@@ -174,13 +251,13 @@ buildField(name, dimension, type, initList)
 	result->offset = 0;
 	result->invisible = FALSE;
 	val = evaluate(dimension);
-	if (isInteger(val) && val->value > 0)
-		result->dimension = val->value;
+	if (isInteger(val) && val.value > 0)
+		result->dimension = val.value;
 	else {
 		error("illegal data type for field dimension\n");
 		result->dimension = 1;
 	}
-	freeValue(val);
+	freeExpr(dimension);
 	result->initValues = initList;
 	return(result);
 }
@@ -0,0 +1,468 @@
+/*
+	The griddle library proper: compilation contexts and the symbol table,
+	input stack and error reporting that every context uses.  griddle and
+	fred (main.c) are front ends built on top of this.
+ */
+
+#include "griddleDefs.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+__thread griddleContext	*gx;
+
+  griddleContext *
+newGriddleContext(fredMode)
+  boolean	fredMode;
+{
+	griddleContext	*context;
+
+	context = (griddleContext *)calloc(1, sizeof(griddleContext));
+	context->fredMode = fredMode;
+	context->newline = TRUE;
+	context->inptr = "";
+	context->globalIdCounter = 1001;
+	context->classFileName = "class.dat";
+	return(context);
+}
+
+/*
+	Make 'context' the one the calling thread works in, returning the one
+	it was working in before.
+ */
+  griddleContext *
+useGriddleContext(context)
+  griddleContext	*context;
+{
+	griddleContext	*previous;
+
+	previous = gx;
+	gx = context;
+	return(previous);
+}
+
+/*
+	The arena holds what a context keeps until it is freed -- so far
+	the strings and bit strings that variables are set to -- in blocks
+	that are never freed one by one.
+ */
+#define ARENA_BLOCK	8192
+
+typedef struct arenaBlockStruct {
+	struct arenaBlockStruct	*next;
+	int			 used;
+	int			 size;
+	byte			 data[1];
+} arenaBlock;
+
+  void *
+arenaAlloc(size)
+  int	size;
+{
+	arenaBlock	*block;
+	void		*result;
+
+	size = (size + sizeof(intptr_t) - 1) & ~(sizeof(intptr_t) - 1);
+	block = gx->arena;
+	if (block == NULL || block->size - block->used < size) {
+		block = (arenaBlock *)malloc(sizeof(arenaBlock) +
+			(size > ARENA_BLOCK ? size : ARENA_BLOCK));
+		block->used = 0;
+		block->size = size > ARENA_BLOCK ? size : ARENA_BLOCK;
+		block->next = gx->arena;
+		gx->arena = block;
+	}
+	result = block->data + block->used;
+	block->used += size;
+	return(result);
+}
+
+  static void
+freeArena(block)
+  arenaBlock	*block;
+{
+	arenaBlock	*next;
+
+	for (; block != NULL; block = next) {
+		next = block->next;
+		free(block);
+	}
+}
+
+/*
+	Copy the string or bit string 'val' points at into the arena, so it
+	can outlive the expression it came from.
+ */
+  value
+keepValue(val)
+  value	val;
+{
+	char	*string;
+	byte	*bits;
+	int	 length;
+
+	if (val.dataType == VAL_STRING) {
+		string = arenaAlloc(strlen((char *)val.value) + 1);
+		strcpy(string, (char *)val.value);
+		val.value = (intptr_t)string;
+	} else if (val.dataType == VAL_BITSTRING) {
+		length = ((*(byte *)val.value + 7) >> 3) + 1;
+		bits = arenaAlloc(length);
+		memcpy(bits, (byte *)val.value, length);
+		val.value = (intptr_t)bits;
+	}
+	return(val);
+}
+
+  void
+freeGriddleContext(context)
+  griddleContext	*context;
+{
+	griddleContext	*previous;
+	symbol		*sym;
+	symbol		*next;
+	int		 i;
+
+	previous = useGriddleContext(context);
+	resetRegionCounters();
+	for (i=0; i<HASH_MAX; ++i) {
+		for (sym = context->symbolTable[i]; sym != NULL; sym = next) {
+			next = sym->next;
+			if (sym->type == OBJECT_SYM)
+				free(sym->def.object);
+			free(sym->name);
+			free(sym);
+		}
+	}
+	for (i=0; i<MAXCLASS+1; ++i) {
+		if (context->classDefs[i] != NULL) {
+			free(context->classDefs[i]->prototype);
+			free(context->classDefs[i]);
+		}
+	}
+	if (context->rawRecord != NULL)
+		free(context->rawRecord);
+	freeArena(context->arena);
+	freeExprPool(context);
+	if (context->scratchIds != NULL)
+		free(context->scratchIds);
+	useGriddleContext(previous == context ? NULL : previous);
+	free(context);
+}
+
+  void
+resetRegionCounters()
+{
+	int	i;
+
+	for (i=0; i<gx->objectCount; ++i) {
+		if (gx->noidArray[i] != NULL) {
+			freeObject(gx->noidArray[i]);
+			gx->noidArray[i] = NULL;
+		}
+	}
+	gx->globalIdCounter = 1001;
+	gx->objectCount = 0;
+	gx->rawCount = 0;
+	clearScratchIds();
+	gx->useStartCount = 0;
+}
+
+
+  int
+hash(s)
+  char	*s;
+{
+	int	result;
+
+	result = 0;
+	while (*s != '\0')
+		result = (result << 1) ^ *s++;
+	return(result & (HASH_MAX - 1));
+}
+
+  symbol *
+insertSymbol(name)
+  char	*name;
+{
+	symbol	*newSymbol;
+	int	 hashval;
+	symbol	*mptr;
+	symbol	*oldmptr;
+	int	 cmp;
+
+	newSymbol = typeAlloc(symbol);
+	newSymbol->name = malloc(strlen(name) + 1);
+	newSymbol->type = NON_SYM;
+	newSymbol->codeNumber = 0;
+	strcpy(newSymbol->name, name);
+	hashval = hash(name);
+	mptr = gx->symbolTable[hashval];
+	oldmptr = NULL;
+	while (mptr != NULL) {
+		if ((cmp = strcmp(name, mptr->name)) == 0) {
+			error("Hey, symbol %s already in table!", name);
+			fatalExit();
+		} else if (cmp > 0) {
+			break;
+		} else {
+			oldmptr = mptr;
+			mptr = mptr->next;
+		}
+	}
+	if (oldmptr == NULL)
+		gx->symbolTable[hashval] = newSymbol;
+	else
+		oldmptr->next = newSymbol;
+	newSymbol->next = mptr;
+	return(newSymbol);
+}
+
+  symbol *
+lookupSymbol(name)
+  char	*name;
+{
+	symbol	*result;
+	int	 cmp;
+
+	result = gx->symbolTable[hash(name)];
+	while (result != NULL) {
+		if ((cmp = strcmp(name, result->name)) == 0)
+			return(result);
+		else if (cmp > 0)
+			result = NULL;
+		else
+			result = result->next;
+	}
+	return(insertSymbol(name));
+}
+
+  void
+yyerror(s)
+  char *s;
+{
+	error("\"%s\", line %d: %s\n", gx->currentFileName, gx->currentLineNumber, s);
+}
+
+
+  fileList *
+newInputSource(name)
+  char	*name;
+{
+	fileList	*source;
+
+	source = typeAlloc(fileList);
+	source->next = NULL;
+	source->saveLine = 1;
+	source->saveName = name;
+	source->buffer = source->bufferEnd = source->savePtr = NULL;
+	source->mapLength = 0;
+	return(source);
+}
+
+/*
+	Read all of 'fd' into a NUL terminated buffer.
+ */
+  static char *
+readWhole(fd, lengthptr)
+  int	 fd;
+  size_t	*lengthptr;
+{
+	char	*buf;
+	size_t	 size;
+	size_t	 length;
+	ssize_t	 count;
+
+	size = 8192;
+	length = 0;
+	buf = malloc(size);
+	while ((count = read(fd, buf + length, size - length - 1)) > 0) {
+		length += count;
+		if (size - length < 2)
+			buf = realloc(buf, size *= 2);
+	}
+	buf[length] = '\0';
+	*lengthptr = length;
+	return(buf);
+}
+
+/*
+	Bring the text of 'source' into memory.  A regular file whose size is
+	not a multiple of the page size is mapped, since the rest of its last
+	page reads as zeros and so supplies the terminating NUL for free;
+	anything else is read.
+ */
+  boolean
+loadInputSource(source)
+  fileList	*source;
+{
+	struct stat	 st;
+	int		 fd;
+	size_t		 length;
+	char		*map;
+
+	if (source->buffer == NULL) {
+		if (strcmp(source->saveName, "-") == 0) {
+			source->saveName = "<standard input>";
+			source->buffer = readWhole(0, &length);
+		} else {
+			if ((fd = open(source->saveName, O_RDONLY)) < 0)
+				return(FALSE);
+			map = MAP_FAILED;
+			if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+					st.st_size % getpagesize() != 0) {
+				length = st.st_size;
+				map = mmap(NULL, length, PROT_READ, MAP_PRIVATE,
+					fd, 0);
+			}
+			if (map != MAP_FAILED) {
+				source->buffer = map;
+				source->mapLength = length;
+			} else
+				source->buffer = readWhole(fd, &length);
+			close(fd);
+		}
+		source->bufferEnd = source->buffer + length;
+	}
+	if (source->savePtr == NULL)
+		source->savePtr = source->buffer;
+	source->binary = source->bufferEnd - source->buffer >= BINARY_RAW_HEADER
+		&& memcmp(source->buffer, BINARY_RAW_MAGIC, 4) == 0;
+	return(TRUE);
+}
+
+  void
+releaseInputSource(source)
+  fileList	*source;
+{
+	if (source->mapLength != 0)
+		munmap(source->buffer, source->mapLength);
+	else if (source->buffer != NULL)
+		free(source->buffer);
+	free(source);
+}
+
+/*
+	Drop whatever input is left, after a compile has been given up on.
+ */
+  void
+discardInput()
+{
+	fileList	*next;
+
+	for (; gx->inputStack != NULL; gx->inputStack = next) {
+		next = gx->inputStack->next;
+		releaseInputSource(gx->inputStack);
+	}
+	gx->bottomOfInputStack = NULL;
+	gx->inptr = "";
+	gx->newline = TRUE;
+}
+
+  void
+queueInputFile(name)
+  char	*name;
+{
+	fileList	*newFileName;
+
+	newFileName = newInputSource(name);
+	if (gx->inputStack == NULL) {
+		gx->inputStack = gx->bottomOfInputStack = newFileName;
+	} else {
+		gx->bottomOfInputStack->next = newFileName;
+		gx->bottomOfInputStack = newFileName;
+	}
+}
+
+  void
+queueTemplateFile(name)
+  char	*name;
+{
+	fileList	*source;
+	int		 length;
+
+	queueInputFile(name);
+	source = gx->bottomOfInputStack;
+	if ((source->buffer = openTemplate(name, &length)) != NULL)
+		source->bufferEnd = source->buffer + length;
+}
+
+  boolean
+openFirstFile(fredMode)
+  boolean fredMode;
+{
+	if (gx->inputStack == NULL)
+		queueInputFile("-");
+	if (!loadInputSource(gx->inputStack)) {
+		if (!fredMode)
+			error("can't open input file %s\n",
+				gx->inputStack->saveName);
+		releaseInputSource(gx->inputStack);
+		gx->inputStack = NULL;
+		return(FALSE);
+	}
+	gx->inptr = gx->inputStack->savePtr;
+	gx->currentLineNumber = gx->inputStack->saveLine;
+	gx->currentFileName = gx->inputStack->saveName;
+	return(TRUE);
+}
+
+void error(char	*msg, ...)
+{
+	va_list ap;
+
+	++gx->errorCount;
+	if (gx->quiet)
+		return;
+	fprintf(stderr, "error: ");
+	va_start(ap, msg);
+	vfprintf(stderr, msg, ap);
+	va_end(ap);
+}
+
+void systemError(char	*msg, ...)
+{
+	fprintf(stderr, "error: ");
+	va_list ap;
+	va_start(ap, msg);
+	vfprintf(stderr, msg, ap);
+	va_end(ap);
+	perror("Unix says");
+	fatalExit();
+}
+
+/*
+	Give up after a fatal error.  A context with somewhere to go back to
+	(fatalJump, see prefetch.c) goes there instead of taking the whole
+	process down.
+ */
+  void
+fatalExit()
+{
+	if (gx->fatalJump != NULL)
+		longjmp(*gx->fatalJump, 1);
+	exit(1);
+}
+
+  void
+translate(s, c1, c2)
+  char	*s;
+  char	 c1;
+  char	 c2;
+{
+	for (; *s != '\0'; ++s)
+		if (*s == c1)
+			*s = c2;
+}
+
+  char *
+saveString(s)
+  char *s;
+{
+	char	*result;
+
+	result = (char *)malloc(strlen(s) + 1);
+	strcpy(result, s);
+	return(result);
+}
@@ -2,19 +2,12 @@
 
 #define CLASS_MAX	256
 #define SIZE_OFFSET	12
-int	 classSize[CLASS_MAX];
-
-byte	cv[512];
-int	cvLength;
-
-static FILE	*cvFyle;
-static object	*inNoid[MAXNOID];
 
   void
 cvByte(n)
   byte	n;
 {
-	cv[cvLength++] = n;
+	gx->cv[gx->cvLength++] = n;
 }
 
   byte
@@ -43,16 +36,16 @@ readClassFile()
 	FILE	*classFyle;
 
 
-	if ((classFyle = fopen(classFileName, "r")) == NULL)
-		systemError("can't open class file '%s'\n", classFileName);
+	if ((classFyle = fopen(gx->classFileName, "r")) == NULL)
+		systemError("can't open class file '%s'\n", gx->classFileName);
 	for (i=0; i<CLASS_MAX; ++i)
-		classSize[i] = readWord(classFyle);
+		gx->classSize[i] = readWord(classFyle);
 	for (i=0; i<CLASS_MAX; ++i)
-		if (classSize[i] == 0xFFFF)
-			classSize[i] = 0;
+		if (gx->classSize[i] == 0xFFFF)
+			gx->classSize[i] = 0;
 		else {
-			fseek(classFyle, classSize[i]+SIZE_OFFSET, 0);
-			classSize[i] = (readByte(classFyle) & 0x7F) - 6;
+			fseek(classFyle, gx->classSize[i]+SIZE_OFFSET, 0);
+			gx->classSize[i] = (readByte(classFyle) & 0x7F) - 6;
 		}
 	fclose(classFyle);
 }
@@ -62,10 +55,10 @@ cvNoidClass()
 {
 	int	i;
 
-	for (i=1; i<objectCount; ++i) {
-		if (noidArray[i] != NULL) {
+	for (i=1; i<gx->objectCount; ++i) {
+		if (gx->noidArray[i] != NULL) {
 			cvByte(i);
-			cvByte(noidArray[i]->class);
+			cvByte(gx->noidArray[i]->class);
 		}
 	}
 }
@@ -122,8 +115,8 @@ cvProperties(class, buf)
 			cvByte(0);
 		else
 			cvByte(-container-1001);
-		for (i=0; i<classSize[class]; ++i)
-			cvByte(getWord(buf, objectBase + i*2));
+		for (i=0; i<gx->classSize[class]; ++i)
+			cvByte(getWord(buf, gx->objectBase + i*2));
 	}
 }
 
@@ -132,9 +125,10 @@ cvProps()
 {
 	int	i;
 
-	for (i=1; i<objectCount; ++i)
-	    if (noidArray[i] != NULL)
-		cvProperties(noidArray[i]->class, noidArray[i]->stateVector);
+	for (i=1; i<gx->objectCount; ++i)
+	    if (gx->noidArray[i] != NULL)
+		cvProperties(gx->noidArray[i]->class,
+			gx->noidArray[i]->stateVector);
 }
 
   boolean
@@ -142,12 +136,12 @@ generateContentsVector()
 {
 	int	i;
 
-	cvLength = 0;
-	if (noidArray[0] == NULL || noidArray[0]->class != 0) {
+	gx->cvLength = 0;
+	if (gx->noidArray[0] == NULL || gx->noidArray[0]->class != 0) {
 		error("first object is not a region\n");
 		return(FALSE);
-	} else for (i=1; i<objectCount; ++i) {
-		if (noidArray[i] != NULL && noidArray[i]->class == 0) {
+	} else for (i=1; i<gx->objectCount; ++i) {
+		if (gx->noidArray[i] != NULL && gx->noidArray[i]->class == 0) {
 			error("more than one region given\n");
 			return(FALSE);
 		}
@@ -163,8 +157,12 @@ generateContentsVector()
   void
 outputContentsVector()
 {
+	profilePhase	phase;
+
+	phase = PROFILE_ENTER(PHASE_CV);
 	if (generateContentsVector())
-		fwrite(cv, 1, cvLength, cvFile);
+		fwrite(gx->cv, 1, gx->cvLength, gx->cvFile);
+	PROFILE_LEAVE(phase);
 }
 
   void
@@ -179,33 +177,35 @@ fillFromCvFile(obj)
 	buf = obj->stateVector;
 	class = obj->class;
 	if (class == 0) {
-		readByte(cvFyle); /* skip style */
-		fillWord(buf, LIGHTLEVEL_OFFSET_REG, readByte(cvFyle));
-		fillWord(buf, DEPTH_OFFSET_REG, readByte(cvFyle));
-		fillWord(buf, CLASSGROUP_OFFSET_REG, readByte(cvFyle));
-		readByte(cvFyle); /* skip who am i */
+		readByte(gx->cvFyle); /* skip style */
+		fillWord(buf, LIGHTLEVEL_OFFSET_REG, readByte(gx->cvFyle));
+		fillWord(buf, DEPTH_OFFSET_REG, readByte(gx->cvFyle));
+		fillWord(buf, CLASSGROUP_OFFSET_REG, readByte(gx->cvFyle));
+		readByte(gx->cvFyle); /* skip who am i */
 		for (i=0; i<4; ++i)
-			readByte(cvFyle); /* skip bank balance */
+			readByte(gx->cvFyle); /* skip bank balance */
 	} else if (class == 1) {
-		fillByte(buf, STYLE_OFFSET_AVA, readByte(cvFyle));
-		fillWord(buf, X_OFFSET_AVA, readByte(cvFyle));
-		fillWord(buf, Y_OFFSET_AVA, readByte(cvFyle));
-		fillWord(buf, ORIENT_OFFSET_AVA, readByte(cvFyle));
-		fillWord(buf, GRSTATE_OFFSET_AVA, readByte(cvFyle));
-		container = getLong(inNoid[readByte(cvFyle)]->stateVector, 0);
+		fillByte(buf, STYLE_OFFSET_AVA, readByte(gx->cvFyle));
+		fillWord(buf, X_OFFSET_AVA, readByte(gx->cvFyle));
+		fillWord(buf, Y_OFFSET_AVA, readByte(gx->cvFyle));
+		fillWord(buf, ORIENT_OFFSET_AVA, readByte(gx->cvFyle));
+		fillWord(buf, GRSTATE_OFFSET_AVA, readByte(gx->cvFyle));
+		container = getLong(gx->inNoid[readByte(gx->cvFyle)]->stateVector, 0);
 		fillLong(buf, CONTAINER_OFFSET_AVA, container);
 		for (i=0; i<AVATAR_PROPERTY_COUNT; ++i)
-			fillWord(buf, PROP_BASE_AVA + i*2, readByte(cvFyle));
+			fillWord(buf, PROP_BASE_AVA + i*2,
+				readByte(gx->cvFyle));
 	} else {
-		fillWord(buf, STYLE_OFFSET_OBJ, readByte(cvFyle));
-		fillWord(buf, X_OFFSET_OBJ, readByte(cvFyle));
-		fillWord(buf, Y_OFFSET_OBJ, readByte(cvFyle));
-		fillWord(buf, ORIENT_OFFSET_OBJ, readByte(cvFyle));
-		fillWord(buf, GRSTATE_OFFSET_OBJ, readByte(cvFyle));
-		container = getLong(inNoid[readByte(cvFyle)]->stateVector, 0);
+		fillWord(buf, STYLE_OFFSET_OBJ, readByte(gx->cvFyle));
+		fillWord(buf, X_OFFSET_OBJ, readByte(gx->cvFyle));
+		fillWord(buf, Y_OFFSET_OBJ, readByte(gx->cvFyle));
+		fillWord(buf, ORIENT_OFFSET_OBJ, readByte(gx->cvFyle));
+		fillWord(buf, GRSTATE_OFFSET_OBJ, readByte(gx->cvFyle));
+		container = getLong(gx->inNoid[readByte(gx->cvFyle)]->stateVector, 0);
 		fillLong(buf, CONTAINER_OFFSET_OBJ, container);
-		for (i=0; i<classSize[class]; ++i)
-			fillWord(buf, objectBase + i*2, readByte(cvFyle));
+		for (i=0; i<gx->classSize[class]; ++i)
+			fillWord(buf, gx->objectBase + i*2,
+				readByte(gx->cvFyle));
 	}
 }
 
@@ -213,43 +213,47 @@ fillFromCvFile(obj)
 inputContentsVector(filename)
   char	*filename;
 {
-	int	 i;
-	int	 noid;
-	int	 class;
-	int	 highNoid;
-	int	 noidBase;
-	byte	 noidMap[MAXNOID];
-	object	*initObject();
+	int		 i;
+	int		 noid;
+	int		 class;
+	int		 highNoid;
+	int		 noidBase;
+	byte		 noidMap[MAXNOID];
+	object		*initObject();
+	profilePhase	 phase;
 
-	if ((cvFyle = fopen(filename, "r")) == NULL) {
+	if ((gx->cvFyle = fopen(filename, "r")) == NULL) {
 		error("can't open contents vector input file '%s'\n",
 			filename);
 		return;
 	}
+	phase = PROFILE_ENTER(PHASE_CV);
 	for (i=0; i<MAXNOID; ++i)
-		inNoid[i] = NULL;
+		gx->inNoid[i] = NULL;
 	noidMap[0] = 0;
-	inNoid[0] = initObject(0, -globalIdCounter++);
+	gx->inNoid[0] = initObject(0, -gx->globalIdCounter++);
 	noidBase = 1;
 	do {
-		for (highNoid=noidBase; (noid = readByte(cvFyle)) != 0; ++highNoid) {
-			class = readByte(cvFyle);
+		for (highNoid=noidBase; (noid = readByte(gx->cvFyle)) != 0; ++highNoid) {
+			class = readByte(gx->cvFyle);
 			noidMap[highNoid] = noid;
-			inNoid[noid] = initObject(class, -globalIdCounter++);
+			gx->inNoid[noid] = initObject(class,
+				-gx->globalIdCounter++);
 		}
 		for (i=noidBase; i<highNoid; ++i)
-			fillFromCvFile(inNoid[noidMap[i]]);
+			fillFromCvFile(gx->inNoid[noidMap[i]]);
 		for (i=0; i<highNoid; ++i) {
-			if (objectCount < MAXNOID)
-				noidArray[objectCount++] = inNoid[noidMap[i]];
-			if (griFile != NULL)
-				dumpObject(inNoid[noidMap[i]]);
-			if (rawFile != NULL)
-				outputRawObject(inNoid[noidMap[i]]);
+			if (gx->objectCount < MAXNOID)
+				gx->noidArray[gx->objectCount++] = gx->inNoid[noidMap[i]];
+			if (gx->griFile != NULL)
+				dumpObject(gx->inNoid[noidMap[i]]);
+			if (gx->rawFile != NULL)
+				outputRawObject(gx->inNoid[noidMap[i]]);
 		}
 		noidBase = 0;
-	} while (readByte(cvFyle) != 0 && !feof(cvFyle));
-	fclose(cvFyle);
+	} while (readByte(gx->cvFyle) != 0 && !feof(gx->cvFyle));
+	fclose(gx->cvFyle);
+	PROFILE_LEAVE(phase);
 }
 
   int
@@ -258,11 +262,26 @@ deCvNoidClass(offset)
 {
 	int	i;
 
-	for (; cv[offset] != 0; offset += 2)
+	for (; gx->cv[offset] != 0; offset += 2)
 		;
 	return(offset + 1);
 }
 
+/*
+	The number of contents vector bytes an object of class 'class' has.
+ */
+  int
+cvPropertiesLength(class)
+  int	class;
+{
+	if (class == 0)
+		return(9);
+	else if (class == 1)
+		return(6 + AVATAR_PROPERTY_COUNT);
+	else
+		return(6 + gx->classSize[class]);
+}
+
   int
 deCvProperties(class, buf, offset)
   int	 class;
@@ -272,33 +291,36 @@ deCvProperties(class, buf, offset)
 	int	i;
 
 	if (class == 0) {
-		fillWord(buf, LIGHTLEVEL_OFFSET_REG, cv[offset + 1]);
-		fillWord(buf, DEPTH_OFFSET_REG, cv[offset + 2]);
-		fillWord(buf, CLASSGROUP_OFFSET_REG, cv[offset + 3]);
-		return(9);
+		fillWord(buf, LIGHTLEVEL_OFFSET_REG, gx->cv[offset + 1]);
+		fillWord(buf, DEPTH_OFFSET_REG, gx->cv[offset + 2]);
+		fillWord(buf, CLASSGROUP_OFFSET_REG, gx->cv[offset + 3]);
+		return(cvPropertiesLength(class));
 	} else if (class == 1) {
-		fillByte(buf, STYLE_OFFSET_AVA, cv[offset + 0]);
-		fillWord(buf, X_OFFSET_AVA, cv[offset + 1]);
-		fillWord(buf, Y_OFFSET_AVA, cv[offset + 2]);
-		fillWord(buf, ORIENT_OFFSET_AVA, cv[offset + 3]);
-		fillWord(buf, GRSTATE_OFFSET_AVA, cv[offset + 4]);
-		if (cv[offset + 5] == 0)
+		fillByte(buf, STYLE_OFFSET_AVA, gx->cv[offset + 0]);
+		fillWord(buf, X_OFFSET_AVA, gx->cv[offset + 1]);
+		fillWord(buf, Y_OFFSET_AVA, gx->cv[offset + 2]);
+		fillWord(buf, ORIENT_OFFSET_AVA, gx->cv[offset + 3]);
+		fillWord(buf, GRSTATE_OFFSET_AVA, gx->cv[offset + 4]);
+		if (gx->cv[offset + 5] == 0)
 			fillLong(buf, CONTAINER_OFFSET_AVA, 0);
 		else
-			fillLong(buf, CONTAINER_OFFSET_AVA, -1001-cv[offset+5]);
+			fillLong(buf, CONTAINER_OFFSET_AVA,
+				-1001-gx->cv[offset+5]);
 		for (i=0; i<AVATAR_PROPERTY_COUNT; ++i)
-			fillWord(buf, PROP_BASE_AVA + i*2, cv[offset + 6+i]);
-		return(6 + AVATAR_PROPERTY_COUNT);
+			fillWord(buf, PROP_BASE_AVA + i*2,
+				gx->cv[offset + 6+i]);
+		return(cvPropertiesLength(class));
 	} else {
-		fillWord(buf, STYLE_OFFSET_OBJ, cv[offset + 0]);
-		fillWord(buf, X_OFFSET_OBJ, cv[offset + 1]);
-		fillWord(buf, Y_OFFSET_OBJ, cv[offset + 2]);
-		fillWord(buf, ORIENT_OFFSET_OBJ, cv[offset + 3]);
-		fillWord(buf, GRSTATE_OFFSET_OBJ, cv[offset + 4]);
-		fillLong(buf, CONTAINER_OFFSET_OBJ, -1001-cv[offset + 5]);
-		for (i=0; i<classSize[class]; ++i)
-			fillWord(buf, objectBase + i*2, cv[offset + 6 + i]);
-		return(6 + classSize[class]);
+		fillWord(buf, STYLE_OFFSET_OBJ, gx->cv[offset + 0]);
+		fillWord(buf, X_OFFSET_OBJ, gx->cv[offset + 1]);
+		fillWord(buf, Y_OFFSET_OBJ, gx->cv[offset + 2]);
+		fillWord(buf, ORIENT_OFFSET_OBJ, gx->cv[offset + 3]);
+		fillWord(buf, GRSTATE_OFFSET_OBJ, gx->cv[offset + 4]);
+		fillLong(buf, CONTAINER_OFFSET_OBJ, -1001-gx->cv[offset + 5]);
+		for (i=0; i<gx->classSize[class]; ++i)
+			fillWord(buf, gx->objectBase + i*2,
+				gx->cv[offset + 6 + i]);
+		return(cvPropertiesLength(class));
 	}
 }
 
@@ -309,18 +331,19 @@ deCvProps(noidOffset, stateOffset)
 {
 	int	noid;
 
-	while ((noid = cv[noidOffset]) != 0) {
-		if (cv[noidOffset + 1] != noidArray[noid]->class) {
+	while ((noid = gx->cv[noidOffset]) != 0) {
+		if (gx->cv[noidOffset + 1] != gx->noidArray[noid]->class) {
 			error("class mismatch: cv says %d, we say %d\n",
-				cv[noidOffset + 1], noidArray[noid]->class);
+				gx->cv[noidOffset + 1],
+					gx->noidArray[noid]->class);
 			return(0);
 		}
-		stateOffset += deCvProperties(noidArray[noid]->class,
-			noidArray[noid]->stateVector, stateOffset);
+		stateOffset += deCvProperties(gx->noidArray[noid]->class,
+			gx->noidArray[noid]->stateVector, stateOffset);
 		noidOffset += 2;
-		noidAlive[noid] = TRUE;
+		gx->noidAlive[noid] = TRUE;
 	}
-	if (cv[stateOffset] == 0)
+	if (gx->cv[stateOffset] == 0)
 		return(0);
 	else
 		return(stateOffset + 1);
@@ -332,15 +355,15 @@ degenerateContentsVector()
 	int	offset;
 	int	noid;
 
-	noidAlive[0] = TRUE;
+	gx->noidAlive[0] = TRUE;
 	for (noid=1; noid<MAXNOID; ++noid)
-		noidAlive[noid] = FALSE;
+		gx->noidAlive[noid] = FALSE;
 	offset = 0;
 	while ((offset = deCvProps(offset, deCvNoidClass(offset))) != 0)
 		;
 	for (noid=1; noid<MAXNOID; ++noid)
-		if (!noidAlive[noid] && noidArray[noid] != NULL) {
-			freeObject(noidArray[noid]);
-			noidArray[noid] = NULL;
+		if (!gx->noidAlive[noid] && gx->noidArray[noid] != NULL) {
+			freeObject(gx->noidArray[noid]);
+			gx->noidArray[noid] = NULL;
 		}
 }
@@ -45,7 +45,7 @@ dumpField(aField, buf)
 	char	str[512];
 
 	if (fieldString(aField, buf, str))
-		fprintf(griFile, "  %s\n", str);
+		fprintf(gx->griFile, "  %s\n", str);
 }
 
   boolean
@@ -149,22 +149,56 @@ dumpObject(obj)
   object	*obj;
 {
 	fieldList	*fields;
+	profilePhase	 phase;
 
 	if (obj == NULL)
 		return;
-	fprintf(griFile, "use %s {\n", classDefs[obj->class+1]->className->
+	phase = PROFILE_ENTER(PHASE_OUTPUT);
+	fprintf(gx->griFile, "use %s {\n",
+		gx->classDefs[obj->class+1]->className->
 		name);
 	if (obj->class > 1) {
-		fields = classDefs[0]->fields;
+		fields = gx->classDefs[0]->fields;
 		while (fields != NULL) {
 			dumpField(fields->field, obj->stateVector);
 			fields = fields->nextField;
 		}
 	}
-	fields = classDefs[obj->class+1]->fields;
+	fields = gx->classDefs[obj->class+1]->fields;
 	while (fields != NULL) {
 		dumpField(fields->field, obj->stateVector);
 		fields = fields->nextField;
 	}
-	fprintf(griFile, "}\n");
+	fprintf(gx->griFile, "}\n");
+	PROFILE_LEAVE(phase);
+}
+
+  unsigned long
+hashBytes(hash, buf, len)
+  unsigned long	 hash;
+  byte		*buf;
+  int		 len;
+{
+	while (len-- > 0)
+		hash = ((hash ^ *buf++) * 16777619) & 0xFFFFFFFF;
+	return(hash);
+}
+
+  unsigned long
+hashString(hash, s)
+  unsigned long	 hash;
+  char		*s;
+{
+	return(hashBytes(hash, (byte *)s, strlen(s) + 1));
+}
+
+  unsigned long
+hashInt(hash, n)
+  unsigned long	 hash;
+  int		 n;
+{
+	byte	buf[4];
+
+	fillLong(buf, 0, n);
+	return(hashBytes(hash, buf, 4));
 }
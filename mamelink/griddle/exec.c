@@ -5,28 +5,32 @@ executeInclude(
   char	*filename)
 {
 	fileList	*newFile;
+	int		 length;
 
-	if (announceIncludes) {
+	if (gx->announceIncludes) {
 		fprintf(stderr, "->%s\n", filename);
 		fflush(stderr);
 	}
-	newFile = typeAlloc(fileList);
-	newFile->next = inputStack;
-	newFile->saveName = currentFileName;
-	newFile->saveLine = currentLineNumber;
-	newFile->fyle = currentInput;
-	inputStack = newFile;
-	if ((currentInput = fopen(filename, "r")) == NULL) {
+	gx->inputStack->savePtr = gx->inptr;
+	gx->inputStack->saveLine = gx->currentLineNumber;
+	newFile = newInputSource(filename);
+	if (gx->indirFile != NULL) {
+		newFile->buffer = openTemplate(filename, &length);
+		if (newFile->buffer != NULL)
+			newFile->bufferEnd = newFile->buffer + length;
+	}
+	if ((gx->indirFile != NULL && newFile->buffer == NULL) ||
+			!loadInputSource(newFile)) {
 		error("unable to open include file '%s'\n", filename);
-		exit(1);
+		fatalExit();
 	}
-	currentFileName = filename;
-	currentLineNumber = 1;
-	free(filename);
+	newFile->next = gx->inputStack;
+	gx->inputStack = newFile;
+	gx->inptr = newFile->savePtr;
+	gx->currentFileName = filename;
+	gx->currentLineNumber = 1;
 }
 
-value	*evaluate(expression	*expr);
-
   void
 executeAssignment(
   symbol	*name,
@@ -35,11 +39,12 @@ executeAssignment(
 	if (name->type != NON_SYM && name->type != VARIABLE_SYM) {
 		error("illegal assignment to '%s'\n", name->name);
 	} else {
-		if (name->type == VARIABLE_SYM)
-			freeValue(name->def.value);
 		name->type = VARIABLE_SYM;
-		name->def.value = evaluate(expr);
+		name->def.value = keepValue(evaluate(expr));
+		if (gx->indirectPass == 2)
+			gx->regionSetsSymbols = TRUE;
 	}
+	freeExpr(expr);
 }
 
   void
@@ -73,14 +78,12 @@ fillLong(
 	buf[offset + 3] =  value        & 0xFF;
 }
 
-value		*buildNumber(int val);
-
-  value *
+  value
 nextValue(
   exprList	**dataptr)
 {
 	exprList	*data;
-	value		*val;
+	value		 val;
 
 	if (dataptr == NULL || *dataptr == NULL)
 		return(buildNumber(0));
@@ -90,11 +93,11 @@ nextValue(
 	return(val);
 }
 
-  value *
+  value
 nextIntValue(
   exprList	**dataptr)
 {
-	value		*val;
+	value		 val;
 
 	val = nextValue(dataptr);
 	if (!isInteger(val))
@@ -102,22 +105,22 @@ nextIntValue(
 	return(val);
 }
 
+/*
+	The string returned belongs to the expression it came from.
+ */
   char *
 nextStringValue(
   exprList	**dataptr)
 {
-	value	*val;
-	char	*result;
+	value	val;
 
 	if (dataptr == NULL || *dataptr == NULL)
 		return(NULL);
 	val = nextValue(dataptr);
 	if (isString(val))
-		result = (char *)(val->value);
+		return((char *)(val.value));
 	else
-		result = NULL;
-	freeValue(val);
-	return(result);
+		return(NULL);
 }
 
   int
@@ -133,8 +136,12 @@ contNum(
 adjustValue(
   value	*val)
 {
-	if (indirFile != NULL && val->value < -1000)
-		val->value -= globalIdAdjustment;
+	if (gx->indirFile == NULL || val->value >= -1000)
+		return;
+	if (gx->mapRelativeIds && -1001 - val->value < gx->regionIdCount)
+		val->value = -gx->regionIds[-1001 - val->value];
+	else
+		val->value -= gx->globalIdAdjustment;
 }
 
   void
@@ -142,14 +149,14 @@ fillField(
   byte		*buf,
   exprList	*data,
   field		*aField,
-  value		*(*nextInt)(),
+  value		(*nextInt)(),
   char		*(*nextString)(),
-  value		*(*nextBit)())
+  value		(*nextBit)())
 {
 	int	 i, j;
 	int	 offset, bitOffset;
 	int	 len;
-	value	*val;
+	value	 val;
 	char	*string;
 	byte	*bitString;
 	int	 bitLength;
@@ -157,7 +164,7 @@ fillField(
 	byte	 theBit;
 
 	offset = aField->offset & 0x3FFF;
-	if (indirFile != NULL && offset == IDENT_OFFSET)
+	if (gx->indirFile != NULL && offset == IDENT_OFFSET)
 		return;
 	bitOffset = aField->offset >> 14;
 
@@ -165,54 +172,47 @@ fillField(
 		switch (aField->type) {
 		Case FIELD_ENTITY:
 			val = (*nextInt)(&data);
-			adjustValue(val);
-			fillLong(buf, offset + 6*i, val->value);
-			fillWord(buf, offset + 6*i + 4, contNum(val->dataType));
-			freeValue(val);
+			adjustValue(&val);
+			fillLong(buf, offset + 6*i, val.value);
+			fillWord(buf, offset + 6*i + 4, contNum(val.dataType));
 
 		Case FIELD_AVAID:
 			val = (*nextInt)(&data);
-			if (val->dataType != VAL_AVATAR && val->dataType !=
+			if (val.dataType != VAL_AVATAR && val.dataType !=
 					VAL_INTEGER)
 				error("illegal avatar id value\n");
-			adjustValue(val);
-			fillLong(buf, offset + 4*i, val->value);
-			freeValue(val);
+			adjustValue(&val);
+			fillLong(buf, offset + 4*i, val.value);
 
 		Case FIELD_OBJID:
 			val = (*nextInt)(&data);
-			if (val->dataType != VAL_OBJECT && val->dataType !=
+			if (val.dataType != VAL_OBJECT && val.dataType !=
 					VAL_INTEGER)
 				error("illegal object id value\n");
-			adjustValue(val);
-			fillLong(buf, offset + 4*i, val->value);
-			freeValue(val);
+			adjustValue(&val);
+			fillLong(buf, offset + 4*i, val.value);
 
 		Case FIELD_REGID:
 			val = (*nextInt)(&data);
-			if (val->dataType != VAL_REGION && val->dataType !=
+			if (val.dataType != VAL_REGION && val.dataType !=
 					VAL_INTEGER)
 				error("illegal region id value\n");
-			adjustValue(val);
-			fillLong(buf, offset + 4*i, val->value);
-			freeValue(val);
+			adjustValue(&val);
+			fillLong(buf, offset + 4*i, val.value);
 
 		Case FIELD_BIN31:
 			val = (*nextInt)(&data);
-			fillLong(buf, offset + 4*i, val->value);
-			freeValue(val);
+			fillLong(buf, offset + 4*i, val.value);
 
 		Case FIELD_FATWORD:
 			val = (*nextInt)(&data);
-			fillWord(buf, offset + 4*i, val->value & 0xFF);
-			fillWord(buf, offset + 4*i + 2, (val->value >> 8) &
+			fillWord(buf, offset + 4*i, val.value & 0xFF);
+			fillWord(buf, offset + 4*i + 2, (val.value >> 8) &
 				0xFF);
-			freeValue(val);
 
 		Case FIELD_BIN15:
 			val = (*nextInt)(&data);
-			fillWord(buf, offset + 2*i, val->value);
-			freeValue(val);
+			fillWord(buf, offset + 2*i, val.value);
 
 		Case FIELD_WORDS:
 			string = (*nextString)(&data);
@@ -222,12 +222,10 @@ fillField(
 				       fillWord(buf, offset + i*2, string[i]);
 			for (; i<aField->dimension; ++i)
 				fillWord(buf, offset + i*2, ' ');
-			free(string);
 
 		Case FIELD_BYTE:
 			val = (*nextInt)(&data);
-			fillByte(buf, offset + i, val->value);
-			freeValue(val);
+			fillByte(buf, offset + i, val.value);
 
 		Case FIELD_CHARACTER:
 			string = (*nextString)(&data);
@@ -237,7 +235,6 @@ fillField(
 					fillByte(buf, offset + i, string[i]);
 			for (; i<aField->dimension; ++i)
 				fillByte(buf, offset + i, ' ');
-			freeValue(string);
 
 		Case FIELD_VARSTRING:
 			string = (*nextString)(&data);
@@ -247,7 +244,6 @@ fillField(
 				for (; i<aField->dimension && string != NULL
 						&& string[i] != '\0'; ++i)
 					fillByte(buf, offset+2+i, string[i]);
-				free(string);
 			} else
 				fillWord(buf, offset, 0);
 			i = aField->dimension;
@@ -257,12 +253,12 @@ fillField(
 			if (isInteger(val)) {
 				bufIndex = offset + ((i+bitOffset)>>3);
 				theBit = 1 << (7 - ((i+bitOffset)&7));
-				if (val->value & 1)
+				if (val.value & 1)
 					buf[bufIndex] |= theBit;
 				else
 					buf[bufIndex] &= ~theBit;
-			} else if (val->dataType == VAL_BITSTRING) {
-				bitString = (byte *)val->value;
+			} else if (val.dataType == VAL_BITSTRING) {
+				bitString = (byte *)val.value;
 				bitLength = *bitString++;
 				for (j=0; j < bitLength && i+j <
 					aField->dimension; ++j) {
@@ -280,7 +276,6 @@ fillField(
 				}
 			} else
 				error("invalid data type for bit field\n");
-			freeValue(val);
 		}
 	}
 	if (data != NULL)
@@ -293,11 +288,15 @@ fillPrototype(
   fieldList	*fields,
   int		 class)
 {
+	profilePhase	phase;
+
+	phase = PROFILE_ENTER(PHASE_FILL);
 	while (fields != NULL) {
 		fillField(buf, fields->field->initValues, fields->field,
 			nextIntValue, nextStringValue, nextValue);
 		fields = fields->nextField;
 	}
+	PROFILE_LEAVE(phase);
 }
 
   void
@@ -317,7 +316,7 @@ fillProperty(
 		}
 	}
 	if (class > 1)
-		fillProperty(buf, prop, classDefs[0]->fields, -1);
+		fillProperty(buf, prop, gx->classDefs[0]->fields, -1);
 	else
 		error("no match for field '%s'\n", prop->fieldName->name);
 }
@@ -329,10 +328,14 @@ fillData(buf, fields, properties, class)
   propertyList	*properties;
   int		 class;
 {
+	profilePhase	phase;
+
+	phase = PROFILE_ENTER(PHASE_FILL);
 	while (properties != NULL) {
 		fillProperty(buf, properties->property, fields, class);
 		properties = properties->nextProp;
 	}
+	PROFILE_LEAVE(phase);
 }
 
   object *
@@ -344,20 +347,14 @@ initObject(class, globalId)
 	objectList	*buildObjectList();
 	int		 i;
 
-	if (indirectPass == 1) {
-		if (class == CLASS_REGION)
-			indirTable[indirRegion].region = globalId;
-		result = NULL;
-	} else {
-		result = typeAlloc(object);
-		result->class = class;
-		result->stateVector = byteAlloc(classDefs[class+1]->size);
-		for (i=0; i<classDefs[class+1]->size; ++i)
-		    result->stateVector[i] = classDefs[class+1]->prototype[i];
-		if (class > 1)
-		    fillLong(result->stateVector, 4, class);
-		fillLong(result->stateVector, 0, globalId);
-	}
+	result = typeAlloc(object);
+	result->class = class;
+	result->stateVector = byteAlloc(gx->classDefs[class+1]->size);
+	for (i=0; i<gx->classDefs[class+1]->size; ++i)
+	    result->stateVector[i] = gx->classDefs[class+1]->prototype[i];
+	if (class > 1)
+	    fillLong(result->stateVector, 4, class);
+	fillLong(result->stateVector, 0, globalId);
 	return(result);
 }
 
@@ -366,43 +363,130 @@ generateObject(class, tail)
   int		 class;
   objectTail	*tail;
 {
-	value	*val;
+	value	 val;
 	int	 globalId;
 	object	*result;
 
-	if (tail->idExpr == NULL || indirFile != NULL) {
-		globalId = -globalIdCounter++;
+	if (tail->idExpr == NULL || gx->indirFile != NULL) {
+		if (gx->regionIds != NULL &&
+				gx->regionUseCount < gx->regionIdCount)
+			globalId = -gx->regionIds[gx->regionUseCount++];
+		else
+			globalId = -gx->globalIdCounter;
+		++gx->globalIdCounter;
 	} else {
 		val = evaluate(tail->idExpr);
-		if (!isInteger(val) || val->value <= 0) {
+		if (!isInteger(val) || val.value <= 0) {
 			error("illegal global id number\n");
 			return(NULL);
 		}
-		globalId = val->value;
-		freeValue(val);
+		globalId = val.value;
 	}
 	result = initObject(class, globalId);
-	if (indirectPass != 1)
-		fillData(result->stateVector, classDefs[class+1]->fields,
-			tail->properties, class);
+	fillData(result->stateVector, gx->classDefs[class+1]->fields,
+		tail->properties, class);
 	return(result);
 }
 
+/*
+	The header that starts a binary raw file.  The hash covers the size
+	of every defined class, so a file is only read back against the
+	defines it was written with.
+ */
+  void
+binaryRawHeader(header)
+  byte	*header;
+{
+	unsigned long	hash;
+	int		i;
+
+	hash = HASH_START;
+	for (i=0; i<=MAXCLASS; ++i)
+		if (gx->classDefs[i] != NULL) {
+			hash = hashInt(hash, i - 1);
+			hash = hashInt(hash, gx->classDefs[i]->size);
+		}
+	memcpy(header, BINARY_RAW_MAGIC, 4);
+	for (i=0; i<4; ++i)
+		header[4 + i] = (hash >> (24 - 8*i)) & 0xFF;
+}
+
+/*
+	Start the raw output file off; only a binary one has anything to
+	write ahead of the first object.
+ */
+  void
+beginRawOutput()
+{
+	byte	header[BINARY_RAW_HEADER];
+
+	if (gx->binaryRaw && !gx->rawHeaderWritten && gx->rawFile != NULL) {
+		binaryRawHeader(header);
+		fwrite(header, 1, BINARY_RAW_HEADER, gx->rawFile);
+		gx->rawHeaderWritten = TRUE;
+	}
+}
+
+/*
+	Format 'obj' into gx->rawRecord, as hex text or as a binary record,
+	and return its length.
+ */
+  int
+formatRawObject(obj, binary)
+  object	*obj;
+  boolean	 binary;
+{
+	static char	 hexDigits[] = "0123456789abcdef";
+	byte		*out;
+	int		 size;
+	int		 i;
+
+	size = gx->classDefs[obj->class+1]->size;
+	if (gx->rawRecordSize < 3*size + 16) {
+		if (gx->rawRecord != NULL)
+			free(gx->rawRecord);
+		gx->rawRecordSize = 3*size + 16;
+		gx->rawRecord = byteAlloc(gx->rawRecordSize);
+	}
+	out = gx->rawRecord;
+	if (binary) {
+		*out++ = obj->class;
+		*out++ = size >> 8;
+		*out++ = size & 0xFF;
+		memcpy(out, obj->stateVector, size);
+		out += size;
+	} else {
+		out += sprintf((char *)out, "/%d ", obj->class);
+		for (i=0; i<size; ++i) {
+			if ((i & 31) == 31) {
+				*out++ = '\\';
+				*out++ = '\n';
+			}
+			*out++ = hexDigits[obj->stateVector[i] >> 4];
+			*out++ = hexDigits[obj->stateVector[i] & 0xF];
+		}
+		*out++ = '\n';
+	}
+	return(out - gx->rawRecord);
+}
+
+/*
+	Each object goes out in a single fwrite.
+ */
   void
 outputRawObject(obj)
   object	*obj;
 {
-	int	i;
+	int		length;
+	profilePhase	phase;
 
 	if (obj == NULL)
 		return;
-	fprintf(rawFile, "/%d ", obj->class);
-	for (i=0; i<classDefs[obj->class+1]->size; ++i) {
-		if ((i & 31) == 31)
-			fprintf(rawFile, "\\\n");
-		fprintf(rawFile, "%02x", obj->stateVector[i]);
-	}
-	fprintf(rawFile, "\n");
+	phase = PROFILE_ENTER(PHASE_OUTPUT);
+	beginRawOutput();
+	length = formatRawObject(obj, gx->binaryRaw);
+	fwrite(gx->rawRecord, 1, length, gx->rawFile);
+	PROFILE_LEAVE(phase);
 }
 
   int
@@ -419,25 +503,111 @@ fieldCode(ftype)
 		return(-1);
 }
 
+/*
+	With -R, the relative ID each raw object is given is remembered in
+	an open hash table keyed on its container type (0 region, 1 avatar,
+	2 object) and its global ID, and forgotten when the noid array the
+	relative ID points into is flushed.
+ */
+typedef struct scratchIdStruct {
+	int	container;	/* -1 if the slot is empty */
+	int	id;
+	int	relativeId;
+} scratchId;
+
+  static scratchId *
+findScratchSlot(container, id)
+  int	container;
+  int	id;
+{
+	scratchId	*slot;
+	int		 i;
+
+	i = hashInt(HASH_START + container, id) & (gx->scratchIdSize - 1);
+	for (;;) {
+		slot = &gx->scratchIds[i];
+		if (slot->container < 0 || (slot->container == container &&
+				slot->id == id))
+			return(slot);
+		i = (i + 1) & (gx->scratchIdSize - 1);
+	}
+}
+
+  static void
+setScratchId(container, id, relativeId)
+  int	container;
+  int	id;
+  int	relativeId;
+{
+	scratchId	*old;
+	scratchId	*slot;
+	int		 oldSize;
+	int		 i;
+
+	if (2*(gx->scratchIdCount + 1) > gx->scratchIdSize) {
+		old = gx->scratchIds;
+		oldSize = gx->scratchIdSize;
+		gx->scratchIdSize = oldSize == 0 ? 512 : 2*oldSize;
+		gx->scratchIds = typeAllocMulti(scratchId, gx->scratchIdSize);
+		for (i=0; i<gx->scratchIdSize; ++i)
+			gx->scratchIds[i].container = -1;
+		for (i=0; i<oldSize; ++i)
+			if (old[i].container >= 0)
+				*findScratchSlot(old[i].container, old[i].id) =
+					old[i];
+		free(old);
+	}
+	slot = findScratchSlot(container, id);
+	if (slot->container < 0)
+		++gx->scratchIdCount;
+	slot->container = container;
+	slot->id = id;
+	slot->relativeId = relativeId;
+}
+
+  boolean
+lookupScratchId(container, id, relativeptr)
+  int	 container;
+  int	 id;
+  int	*relativeptr;
+{
+	scratchId	*slot;
+
+	if (gx->scratchIdCount == 0)
+		return(FALSE);
+	slot = findScratchSlot(container > 2 ? 2 : container, id);
+	if (slot->container < 0)
+		return(FALSE);
+	*relativeptr = slot->relativeId;
+	return(TRUE);
+}
+
+  void
+clearScratchIds()
+{
+	int	i;
+
+	if (gx->scratchIdCount == 0)
+		return;
+	for (i=0; i<gx->scratchIdSize; ++i)
+		gx->scratchIds[i].container = -1;
+	gx->scratchIdCount = 0;
+}
+
   int
 relativeId(id, contnum)
   int	id;
   int	contnum;
 {
-	char		 scratchName[15];
-	symbol		*scratchSymbol;
-	symbol		*lookupSymbol();
-
-	sprintf(scratchName, "%c_%d", contCode(contnum), id);
-	scratchSymbol = lookupSymbol(scratchName);
-	if (scratchSymbol->type != VARIABLE_SYM) {
-		if (id < -1000 || 0 < id) {
-			error("undefined %c %d\n", contCode(contnum), id);
-			return(0);
-		} else
-			return(id);
+	int	result;
+
+	if (lookupScratchId(contnum, id, &result))
+		return(result);
+	else if (id < -1000 || 0 < id) {
+		error("undefined %c %d\n", contCode(contnum), id);
+		return(0);
 	} else
-		return(scratchSymbol->def.value->value);
+		return(id);
 }
 
   void
@@ -456,7 +626,7 @@ shiftField(aField, buf, adjust)
 			val = getLong(buf, offset + 6*i);
 			if (val < -1000)
 				fillLong(buf, offset + 6*i, val - adjust);
-			else if (assignRelativeIds)
+			else if (gx->assignRelativeIds)
 				fillLong(buf, offset + 6*i,
 					relativeId(val, getWord(buf, offset +
 					6*i + 4)));
@@ -465,7 +635,7 @@ shiftField(aField, buf, adjust)
 			val = getLong(buf, offset + 4*i);
 			if (val < -1000)
 				fillLong(buf, offset + 4*i, val - adjust);
-			else if (assignRelativeIds)
+			else if (gx->assignRelativeIds)
 				fillLong(buf, offset + 4*i, relativeId(val,
 					fieldCode(aField->type)));
 		}
@@ -478,55 +648,34 @@ shiftRelativeGlobalIds(obj, adjust)
   int		 adjust;
 {
 	fieldList	*fields;
+	profilePhase	 phase;
 
+	phase = PROFILE_ENTER(PHASE_SHIFT);
 	if (obj->class > 1) {
-		fields = classDefs[0]->fields;
+		fields = gx->classDefs[0]->fields;
 		while (fields != NULL) {
 			shiftField(fields->field, obj->stateVector, adjust);
 			fields = fields->nextField;
 		}
 	}
-	fields = classDefs[obj->class+1]->fields;
+	fields = gx->classDefs[obj->class+1]->fields;
 	while (fields != NULL) {
 		shiftField(fields->field, obj->stateVector, adjust);
 		fields = fields->nextField;
 	}
-}
-
-  void
-generateScratchId(class, id, relativeId)
-  int	class;
-  int	id;
-  int	relativeId;
-{
-	char		 scratchName[15];
-	symbol		*scratchSymbol;
-	valueType	 vtype;
-	value		*buildValue();
-	symbol		*lookupSymbol();
-
-	sprintf(scratchName, "%c_%d", contCode(class), id);
-	scratchSymbol = lookupSymbol(scratchName);
-	scratchSymbol->type = VARIABLE_SYM;
-	if (class == 0)
-		vtype = VAL_REGION;
-	else if (class == 1)
-		vtype = VAL_AVATAR;
-	else
-		vtype = VAL_OBJECT;
-	scratchSymbol->def.value = buildValue(vtype, relativeId);
+	PROFILE_LEAVE(phase);
 }
 
   void
 executeRawline(
   object	*obj)
 {
-	if (assignRelativeIds)
-		generateScratchId(obj->class, getLong(obj->stateVector, 0),
-			-1001 - objectCount);
-	shiftRelativeGlobalIds(obj, objectCount - rawCount++);
-	if (objectCount < MAXNOID)
-		noidArray[objectCount++] = obj;
+	if (gx->assignRelativeIds)
+		setScratchId(obj->class > 2 ? 2 : obj->class,
+			getLong(obj->stateVector, 0), -1001 - gx->objectCount);
+	shiftRelativeGlobalIds(obj, gx->objectCount - gx->rawCount++);
+	if (gx->objectCount < MAXNOID)
+		gx->noidArray[gx->objectCount++] = obj;
 }
 
   void
@@ -535,24 +684,16 @@ freeObjectTail(tail)
 {
 	propertyList	*properties;
 	propertyList	*oldProperties;
-	exprList	*expr;
-	exprList	*oldExpr;
 
 	properties = tail->properties;
 	while (properties != NULL) {
-		expr = properties->property->data;
-		while (expr != NULL) {
-			if (indirectPass == 1)
-				freeExpr(expr->expr);
-			oldExpr = expr;
-			expr = expr->nextExpr;
-			free(oldExpr);
-		}
+		freeExprList(properties->property->data);
 		free(properties->property);
 		oldProperties = properties;
 		properties = properties->nextProp;
 		free(oldProperties);
 	}
+	freeExpr(tail->idExpr);
 	free(tail);
 }
 
@@ -572,25 +713,27 @@ executeUse(className, tagName, tail)
 		ultimate = generateObject(className->def.class, tail);
 		freeObjectTail(tail);
 		if (ultimate != NULL && tagName != NULL) {
-			if (ultimate->class == 0)
-				globalIdAdjustment = 0;
+			if (ultimate->class == 0) {
+				gx->globalIdAdjustment = 0;
+				gx->mapRelativeIds = FALSE;
+			}
 			if (tagName->type == OBJECT_SYM)
 				free(tagName->def.object);
-			else if(tagName->type == VARIABLE_SYM)
-				freeValue(tagName->def.value);
 			tagName->type = OBJECT_SYM;
 			tagName->def.object = buildObjectStub(ultimate);
+			if (gx->indirectPass == 2)
+				gx->regionSetsSymbols = TRUE;
 		}
 /*#ifndef FRED*/
 		if (ultimate != NULL) {
 			if (ultimate->class == CLASS_DOOR ||
 					ultimate->class == CLASS_BUILDING)
-				sortObjects = TRUE;
+				gx->sortObjects = TRUE;
 			else if (ultimate->class == CLASS_REGION)
 				flushNoidArray();
-			if (objectCount < MAXNOID && indirectPass != 1)
-				noidArray[objectCount++] = ultimate;
-			else if (indirectPass != 0)
+			if (gx->objectCount < MAXNOID)
+				gx->noidArray[gx->objectCount++] = ultimate;
+			else if (gx->indirectPass != 0)
 				error("more than 256 objects in region\n");
 		}
 /*#endif*/
@@ -622,30 +765,33 @@ cmpObjects(ob1, ob2)
 
 flushNoidArray()
 {
-	int	i;
-
-#ifndef FRED
-	if (indirectPass == 2) {
-		for (i=0; i<objectCount; ++i)
-			altNoidArray[i] = noidArray[i];
-		if (sortObjects)
-			qsort(altNoidArray, objectCount, sizeof(object *),
+	int		i;
+	profilePhase	phase;
+
+	if (gx->indirectPass == 2) {
+		for (i=0; i<gx->objectCount; ++i)
+			gx->altNoidArray[i] = gx->noidArray[i];
+		phase = PROFILE_ENTER(PHASE_SORT);
+		if (gx->sortObjects)
+			qsort(gx->altNoidArray, gx->objectCount,
+				sizeof(object *),
 				cmpObjects);
-		for (i=0; i<objectCount; ++i)
-			replaceIndirectArgs(altNoidArray[i], i);
+		PROFILE_LEAVE(phase);
+		for (i=0; i<gx->objectCount; ++i)
+			replaceIndirectArgs(gx->altNoidArray[i], i);
 	}
-	sortObjects = FALSE;
-#endif
-	for (i=0; i<objectCount; ++i) {
-#ifndef FRED
-		if (griFile != NULL && indirectPass != 1)
-			dumpObject(noidArray[i]);
-		if (rawFile != NULL && indirectPass != 1)
-			outputRawObject(noidArray[i]);
-#endif
-		freeObject(noidArray[i]);
+	gx->sortObjects = FALSE;
+	for (i=0; i<gx->objectCount; ++i) {
+		if (gx->griFile != NULL)
+			dumpObject(gx->noidArray[i]);
+		if (gx->rawFile != NULL)
+			outputRawObject(gx->noidArray[i]);
+		if (gx->archiveData != NULL && gx->noidArray[i] != NULL)
+			archiveObject(gx->noidArray[i]);
+		freeObject(gx->noidArray[i]);
 	}
-	objectCount = 0;
+	gx->objectCount = 0;
+	clearScratchIds();
 }
 
 freeObject(obj)
@@ -655,51 +801,42 @@ freeObject(obj)
 	free(obj);
 }
 
-freeValue(val)
-  value	*val;
-{
-	if (val != NULL) {
-		if (val->dataType == VAL_STRING ||
-				val->dataType == VAL_BITSTRING)
-			free(val->value);
-		free(val);
-	}
-}
-
   void
 executeDefine(classExpr, name, fields)
   expression	*classExpr;
   char		*name;
   fieldList	*fields;
 {
-	value	*val;
+	value	 val;
 	int	 class;
 	symbol	*symb;
 	symbol	*lookupSymbol();
 	int	 size;
 
 	val = evaluate(classExpr);
-	class = val->value;
+	freeExpr(classExpr);
+	class = val.value;
 	if (!isInteger(val))
 		error("non-integer value used for class number\n");
 	else if (class < -1 || MAXCLASS <= class)
 		error("class value %d out of range\n", class);
-	else if (classDefs[class+1] != NULL)
+	else if (gx->classDefs[class+1] != NULL)
 		error("class %d already defined\n", class);
 	else {
 		translate(name, ' ', '_');
 		symb = lookupSymbol(name);
 		symb->type = CLASS_SYM;
 		symb->def.class = class;
-		classDefs[class+1] = typeAlloc(classDescriptor);
+		if (gx->indirectPass == 2)
+			gx->regionSetsSymbols = TRUE;
+		gx->classDefs[class+1] = typeAlloc(classDescriptor);
 		size = computeFieldOffsets(fields, class);
-		classDefs[class+1]->size = size;
-		classDefs[class+1]->fields = fields;
-		classDefs[class+1]->className = symb;
-		classDefs[class+1]->prototype = (byte *)malloc(size);
-		fillPrototype(classDefs[class+1]->prototype, fields, class);
+		gx->classDefs[class+1]->size = size;
+		gx->classDefs[class+1]->fields = fields;
+		gx->classDefs[class+1]->className = symb;
+		gx->classDefs[class+1]->prototype = (byte *)malloc(size);
+		fillPrototype(gx->classDefs[class+1]->prototype, fields, class);
 	}
-	freeValue(val);
 	free(name);
 }
 
@@ -713,7 +850,7 @@ computeFieldOffsets(fields, class)
 	field	*aField;
 
 	if (class > 1)
-		offset = objectBase;
+		offset = gx->objectBase;
 	else
 		offset = 0;
 	if (fields == NULL)
@@ -725,7 +862,7 @@ computeFieldOffsets(fields, class)
 		aField->offset = offset + (bitOffset << 14);
 
 		if (class == -1)
-			objectBase = offset;
+			gx->objectBase = offset;
 
 		switch (aField->type) {
 		Case FIELD_ENTITY:
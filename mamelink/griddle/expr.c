@@ -1,83 +1,85 @@
-#include "y.tab.h"
 #include "griddleDefs.h"
+#include "y.tab.h"
 
-value		*buildNumber(int val);
+value		buildNumber(int val);
 
-  value *
+  value
 integerize(val)
-  value *val;
+  value	val;
 {
 	char	*string;
 	int	 i;
 
-	if (val == NULL) {
-		val = buildNumber(0);
-	} else if (val->dataType == VAL_UNDEFINED) {
-		val->value = 0;
-		val->dataType = VAL_INTEGER;
-	} else if (val->dataType == VAL_STRING) {
-		string = (char *)val->value;
-		val->value = 0;
+	if (val.dataType == VAL_UNDEFINED) {
+		val.value = 0;
+		val.dataType = VAL_INTEGER;
+	} else if (val.dataType == VAL_STRING) {
+		string = (char *)val.value;
+		val.value = 0;
 		for (i=0; i < 4 && string[i] != '\0'; ++i)
-			val->value = val->value * 256 + string[i];
-		val->dataType = VAL_INTEGER;
-	} else if (val->dataType == VAL_BITSTRING) {
+			val.value = val.value * 256 + string[i];
+		val.value = (int)val.value;
+		val.dataType = VAL_INTEGER;
+	} else if (val.dataType == VAL_BITSTRING) {
 		/* do something */
-		val->value = 0;
-		val->dataType = VAL_INTEGER;
+		val.value = 0;
+		val.dataType = VAL_INTEGER;
 	}
 	return(val);
 }
 
   boolean
 isInteger(val)
-  value	*val;
+  value	val;
 {
-	return(val != NULL && 
-	       (val->dataType == VAL_INTEGER || val->dataType == VAL_AVATAR ||
-	        val->dataType == VAL_OBJECT || val->dataType == VAL_REGION));
+	return(val.dataType == VAL_INTEGER || val.dataType == VAL_AVATAR ||
+	       val.dataType == VAL_OBJECT || val.dataType == VAL_REGION);
 }
 
   boolean
 isString(val)
-  value *val;
+  value	val;
 {
-	return(val->dataType == VAL_STRING);
+	return(val.dataType == VAL_STRING);
 }
 
-  value *
+/*
+	Evaluate 'expr', leaving it intact.  A string or bit string result
+	points into the expression, so it is only good for as long as the
+	expression is.
+ */
+  value
 evaluate(expr)
   expression	*expr;
 {
-	value	*result;
-	value	*evaluateName();
-	value	*evaluateUnop();
-	value	*evaluateBin();
-	value	*buildNumber();
-	value	*buildString();
-	value	*buildBitString();
+	value		result;
+	value		evaluateName();
+	value		evaluateUnop();
+	value		evaluateBin();
+	profilePhase	phase;
 
+	phase = PROFILE_ENTER(PHASE_EVALUATE);
 	switch (expr->type) {
 	Case ID_EXPR:
-		result = evaluateName(expr->part1);
+		result = evaluateName(expr->part.name);
 	Case NUM_EXPR:
-		result = buildNumber((int) expr->part1);
+		result = buildValue((valueType)expr->oper, expr->part.number);
 	Case EXPR_EXPR:
-		result = evaluate(expr->part1);
+		result = evaluate(expr->part.operand);
 	Case UNOP_EXPR:
-		result = evaluateUnop(expr->part1, evaluate(expr->part2));
+		result = evaluateUnop(expr->oper, evaluate(expr->part.operand));
 	Case BIN_EXPR:
-		result = evaluateBin(evaluate(expr->part1), expr->part2,
-			evaluate(expr->part3));
+		result = evaluateBin(evaluate(expr->part.operand), expr->oper,
+			evaluate(expr->right));
 	Case STRING_EXPR:
-		result = buildString((char *) expr->part1);
+		result = buildString(expr->part.string);
 	Case BITSTRING_EXPR:
-		result = buildBitString((byte *) expr->part1);
+		result = buildBitString(expr->part.bitString);
 	Default:
 		printf("bad expr type leaked thru!\n");
-		exit(1);
+		fatalExit();
 	}
-	free(expr);
+	PROFILE_LEAVE(phase);
 	return(result);
 }
 
@@ -85,169 +87,258 @@ evaluate(expr)
 freeExpr(expr)
   expression	*expr;
 {
+	if (expr == NULL)
+		return;
 	switch (expr->type) {
 		Case EXPR_EXPR:
-			freeExpr(expr->part1);
-		Case UNOP_EXPR:
-			freeExpr(expr->part2);
+		case UNOP_EXPR:
+			freeExpr(expr->part.operand);
 		Case BIN_EXPR:
-			freeExpr(expr->part1);
-			freeExpr(expr->part3);
+			freeExpr(expr->part.operand);
+			freeExpr(expr->right);
 		Case STRING_EXPR:
-			free(expr->part1);
+			free(expr->part.string);
 		Case BITSTRING_EXPR:
-			free(expr->part1);
+			free(expr->part.bitString);
 	}
-	free(expr);
+	expr->right = gx->freeExprs;
+	gx->freeExprs = expr;
 }
 
-  value *
+  void
+freeExprList(list)
+  exprList	*list;
+{
+	exprList	*next;
+
+	for (; list != NULL; list = next) {
+		next = list->nextExpr;
+		freeExpr(list->expr);
+		free(list);
+	}
+}
+
+/*
+	Called on each name and operator node as it is built.  If its value
+	is already known -- its operands are numbers, or it names a variable
+	holding an integer -- turn it into a NUM_EXPR, so that evaluate() has
+	nothing left to do for it.  Variables can be read this early since a
+	statement always runs before the next one is parsed.  Anything that
+	would draw an error is left alone for evaluate() to report.
+ */
+  expression *
+foldExpr(expr)
+  expression	*expr;
+{
+	value	val;
+	value	opnd1, opnd2;
+	value	evaluateUnop();
+	value	evaluateBin();
+
+	switch (expr->type) {
+	Case ID_EXPR:
+		if (expr->part.name->type != VARIABLE_SYM ||
+				!isInteger(expr->part.name->def.value))
+			return(expr);
+		val = expr->part.name->def.value;
+	Case EXPR_EXPR:
+		if (expr->part.operand->type != NUM_EXPR)
+			return(expr);
+		val = evaluate(expr->part.operand);
+	Case UNOP_EXPR:
+		if (expr->part.operand->type != NUM_EXPR)
+			return(expr);
+		val = evaluate(expr->part.operand);
+		if (val.dataType != VAL_INTEGER &&
+			((expr->oper == A && val.dataType != VAL_AVATAR) ||
+			 (expr->oper == O && val.dataType != VAL_OBJECT) ||
+			 (expr->oper == R && val.dataType != VAL_REGION)))
+			return(expr);
+		val = evaluateUnop(expr->oper, val);
+	Case BIN_EXPR:
+		if (expr->part.operand->type != NUM_EXPR ||
+				expr->right->type != NUM_EXPR)
+			return(expr);
+		opnd1 = evaluate(expr->part.operand);
+		opnd2 = evaluate(expr->right);
+		if ((expr->oper == DIV || expr->oper == MOD) &&
+				opnd2.value == 0)
+			return(expr);
+		if (opnd1.dataType != opnd2.dataType &&
+				opnd1.dataType != VAL_INTEGER &&
+				opnd2.dataType != VAL_INTEGER)
+			return(expr);
+		val = evaluateBin(opnd1, expr->oper, opnd2);
+	Default:
+		return(expr);
+	}
+	if (expr->type != ID_EXPR) {
+		freeExpr(expr->part.operand);
+		freeExpr(expr->right);
+	}
+	expr->type = NUM_EXPR;
+	expr->oper = val.dataType;
+	expr->part.number = val.value;
+	expr->right = NULL;
+	return(expr);
+}
+
+  value
 evaluateUnop(oper, opnd)
-  int	 oper;
-  value	*opnd;
+  int	oper;
+  value	opnd;
 {
 	opnd = integerize(opnd);
 	switch(oper) {
 		Case NOT:
-			opnd->value = ~opnd->value;
+			opnd.value = (int)~opnd.value;
 
 		Case UMINUS:
-			opnd->value = -opnd->value;
+			opnd.value = (int)-opnd.value;
 
 		Case A:
-			if (opnd->dataType == VAL_OBJECT ||
-					opnd->dataType == VAL_REGION)
+			if (opnd.dataType == VAL_OBJECT ||
+					opnd.dataType == VAL_REGION)
 				error("incompatible type coercion\n");
-			opnd->dataType = VAL_AVATAR;
+			opnd.dataType = VAL_AVATAR;
 
 		Case O:
-			if (opnd->dataType == VAL_AVATAR ||
-					opnd->dataType == VAL_REGION)
+			if (opnd.dataType == VAL_AVATAR ||
+					opnd.dataType == VAL_REGION)
 				error("incompatible type coercion\n");
-			opnd->dataType = VAL_OBJECT;
+			opnd.dataType = VAL_OBJECT;
 
 		Case R:
-			if (opnd->dataType == VAL_OBJECT ||
-					opnd->dataType == VAL_AVATAR)
+			if (opnd.dataType == VAL_OBJECT ||
+					opnd.dataType == VAL_AVATAR)
 				error("incompatible type coercion\n");
-			opnd->dataType = VAL_REGION;
+			opnd.dataType = VAL_REGION;
 
 		Default:
 			printf("bad unop leaked thru!\n");
-			exit(1);
+			fatalExit();
 	}
 	return(opnd);
 }
 
-  value *
+  value
 evaluateBin(opnd1, oper, opnd2)
-  value	*opnd1;
-  int	 oper;
-  value	*opnd2;
+  value	opnd1;
+  int	oper;
+  value	opnd2;
 {
 	opnd1 = integerize(opnd1);
 	opnd2 = integerize(opnd2);
 	switch(oper) {
 		case ADD:
-			opnd1->value += opnd2->value;
+			opnd1.value += opnd2.value;
 			break;
 		case SUB:
-			opnd1->value -= opnd2->value;
+			opnd1.value -= opnd2.value;
 			break;
 		case MUL:
-			opnd1->value *= opnd2->value;
+			opnd1.value *= opnd2.value;
 			break;
 		case DIV:
-			opnd1->value /= opnd2->value;
+			opnd1.value /= opnd2.value;
 			break;
 		case MOD:
-			opnd1->value %= opnd2->value;
+			opnd1.value %= opnd2.value;
 			break;
 		case AND:
-			opnd1->value &= opnd2->value;
+			opnd1.value &= opnd2.value;
 			break;
 		case OR:
-			opnd1->value |= opnd2->value;
+			opnd1.value |= opnd2.value;
 			break;
 		case XOR:
-			opnd1->value ^= opnd2->value;
+			opnd1.value ^= opnd2.value;
 			break;
 		default:
 			printf("bad binop leaked thru!\n");
-			exit(1);
+			fatalExit();
 	}
-	if (opnd1->dataType != opnd2->dataType) {
-		if (opnd1->dataType == VAL_INTEGER)
-			opnd1->dataType = opnd2->dataType;
-		else if (opnd2->dataType != VAL_INTEGER)
+	opnd1.value = (int)opnd1.value;
+	if (opnd1.dataType != opnd2.dataType) {
+		if (opnd1.dataType == VAL_INTEGER)
+			opnd1.dataType = opnd2.dataType;
+		else if (opnd2.dataType != VAL_INTEGER)
 			error("incompatible type combination");
 	}
-	free(opnd2);
 	return(opnd1);
 }
 
-#ifdef FRED
-  value *
-valueFromName(name)
+/*
+	fred accepts names like o_12 for IDs that are not defined yet, and
+	with -R they name the raw objects read so far by their global IDs.
+ */
+  boolean
+valueFromName(name, valptr)
   char	*name;
+  value	*valptr;
 {
-	int	 len;
-	int	 i;
-	int	 result;
-	value	*buildValue();
+	int	len;
+	int	i;
+	int	result;
 
 	if ((len = strlen(name)) < 3 || name[1] != '_')
-		return(NULL);
+		return(FALSE);
 	result = 0;
 	for (i=2; i<len; ++i)
 		if ('0' <= name[i] && name[i] <= '9')
 			result = result * 10 + name[i] - '0';
 		else
-			return(NULL);
+			return(FALSE);
 	if (name[0] == 'r')
-		return(buildValue(VAL_REGION, result));
+		*valptr = buildValue(VAL_REGION, result);
 	else if (name[0] == 'o')
-		return(buildValue(VAL_OBJECT, result));
+		*valptr = buildValue(VAL_OBJECT, result);
 	else if (name[0] == 'a')
-		return(buildValue(VAL_AVATAR, result));
+		*valptr = buildValue(VAL_AVATAR, result);
 	else
-		return(NULL);
+		return(FALSE);
+	return(TRUE);
 }
-#endif
 
-  value *
+  value
 evaluateName(name)
   symbol	*name;
 {
-	value	*buildNumber();
-	value	*buildValue();
-	value	*result;
+	value	result;
+	int	relative;
 
 	switch(name->type) {
 		case VARIABLE_SYM:
-			return(buildValue(name->def.value->dataType,
-				name->def.value->value));
+			return(name->def.value);
 		case MACRO_SYM:
 			return(evaluate(name->def.expr));
 		case OBJECT_SYM:
 			result = buildNumber(name->def.object->id);
 			if (name->def.object->class == 0)
-				result->dataType = VAL_REGION;
+				result.dataType = VAL_REGION;
 			else if (name->def.object->class == 1)
-				result->dataType = VAL_AVATAR;
+				result.dataType = VAL_AVATAR;
 			else
-				result->dataType = VAL_OBJECT;
+				result.dataType = VAL_OBJECT;
 			return(result);
 		case NON_SYM:
-#ifdef FRED
-			if ((result = valueFromName(name->name)) != NULL)
+			if (gx->fredMode && valueFromName(name->name, &result))
+				return(result);
+			if (gx->assignRelativeIds &&
+					valueFromName(name->name, &result) &&
+					lookupScratchId(contNum(result.dataType),
+					result.value, &relative)) {
+				result.value = relative;
 				return(result);
-#endif
-			printf("symbol %s undefined\n", name->name);
+			}
+			if (gx->quiet)
+				++gx->errorCount;
+			else
+				printf("symbol %s undefined\n", name->name);
 			return(buildNumber(0));
 			
 		default:
 			printf("bad symbol type leaked thru!\n");
-			exit(1);
+			fatalExit();
 	}
 }
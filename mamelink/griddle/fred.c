@@ -3,6 +3,9 @@
 #include "griddleDefs.h"
 #include "prot.h"
 #include "y.tab.h"
+#include "fstats.h"
+
+#define MAXSTATLINE	1000
 
 static int selectedField = 0;
 static int selectedPath = 0;
@@ -15,7 +18,8 @@ static boolean changedFlag = FALSE;
 static char paths[10][80];
 static char pathFileName[80];
 
-int fredStats[128];
+commandStats fredStats[FSTATS_KEYS];
+static boolean statsReadable = TRUE;
 
 typedef struct {
 	char			 commandKey;
@@ -29,10 +33,13 @@ void lineError();
 boolean getString();
 boolean processCommand();
 void displayOneObject();
+char *keyName();
+char commandgetch();
 
 boolean saveGriddle(), initC64editor(), loadRegion(), quit(), saveRaw(), sh();
+boolean saveBinaryRaw();
 boolean refreshScreen(), showNoids(), displayObject(), incDisplayObject();
-boolean decDisplayObject(), createObject(), help(), touch(), undeleteObject();
+boolean decDisplayObject(), createObject(), help(), touch(), undo(), redo();
 boolean deleteObject(), foreground(), background(), incX_4(), decX_4();
 boolean incY_1(), decY_1(), incY_10(), decY_10(), zeroGrState(), incGrState();
 boolean toggleOrient(), editObject(), nightMode(), walkto(), showFlatTypes();
@@ -80,11 +87,13 @@ command commandTable[] = {
 	'S', "inc grState", incGrState, "inc object's grState",
 	't', "touch object under cursor", touch, "touch object under cursor",
 	'T', "twin object", twinObject, "twin object",
-	'u', "undelete deleted object", undeleteObject,
-		"undo object deletion",
+	'u', "undo", undo, "undo the last change",
+	'U', "redo", redo, "redo the last change undone",
 	'w', "walk to indicated object", walkto, "walk avatar to object",
 	'x', "delete object", deleteObject, "delete an object",
 	'z', "raw format save", saveRaw, "save in raw format",
+	'Z', "binary raw format save", saveBinaryRaw,
+		"save in binary raw format",
 	'+', "display object", incDisplayObject, "inc display noid",
 	'-', "display object", decDisplayObject, "dec display noid",
 	'!', "unix command", sh, "execute a Unix command",
@@ -110,10 +119,10 @@ int port = 0;
 c64_override_command(cmd)
   byte cmd;
 {
-	if (!testMode) {
-		down(&cmd, (word) 1, KEYBOARD_OVERRIDE);
-		Cont();
-		sleep(1);
+	if (!gx->testMode) {
+		linkDown(&cmd, (word) 1, KEYBOARD_OVERRIDE);
+		linkCont();
+		linkPause(1);
 	}
 }
 
@@ -124,10 +133,10 @@ c64_key_command(cmd)
 	byte buf;
 
 	buf = cmd;
-	if (!testMode) {
-		down(&buf, (word) 1, KEYBOARD_KEYPRESS);
-		Cont();
-		sleep(1);
+	if (!gx->testMode) {
+		linkDown(&buf, (word) 1, KEYBOARD_KEYPRESS);
+		linkCont();
+		linkPause(1);
 	}
 }
 
@@ -138,40 +147,111 @@ c64_touch_command(arg)
 	byte buf;
 
 	buf = arg;
-	if (!testMode) {
-		down(&buf, (word) 1, TOUCH_SLOT);
-		Cont();
+	if (!gx->testMode) {
+		linkDown(&buf, (word) 1, TOUCH_SLOT);
+		linkCont();
 	}
 }
 
+/*
+	Read the statistics kept so far, in either format (see fstats.h).
+	Statistics written by a later fred are left alone.
+ */
   void
 readFredStats()
 {
-	FILE	*statFyle;
-	int	 i;
-
-	if ((statFyle = fopen("fredStats", "r")) != NULL) {
-		for (i=0; i<128; ++i)
-			fredStats[i] = getw(statFyle);
-		fclose(statFyle);
-	}
-	if (statFyle == NULL || feof(statFyle)) {
-		for (i=0; i<128; ++i)
-			fredStats[i] = 0;
+	FILE		*statFyle;
+	char		 line[MAXSTATLINE];
+	char		 kind[20];
+	char		*p;
+	commandStats	*stats;
+	int		 key;
+	long		 count;
+	int		 i, j;
+
+	memset(fredStats, 0, sizeof(fredStats));
+	if ((statFyle = fopen("fredStats", "r")) == NULL)
+		return;
+	if (fgets(line, MAXSTATLINE, statFyle) == NULL ||
+			strncmp(line, FSTATS_MAGIC " ",
+			strlen(FSTATS_MAGIC) + 1) != 0) {
+		rewind(statFyle);
+		for (i=0; i<FSTATS_KEYS; ++i) {
+			count = getw(statFyle);
+			if (feof(statFyle))
+				break;
+			fredStats[i].count = count;
+		}
+	} else if (atoi(line + strlen(FSTATS_MAGIC)) != FSTATS_VERSION) {
+		statsReadable = FALSE;
+	} else {
+		stats = NULL;
+		while (fgets(line, MAXSTATLINE, statFyle) != NULL) {
+			if (sscanf(line, "key %d %ld", &key, &count) == 2) {
+				stats = 0 <= key && key < FSTATS_KEYS ?
+					&fredStats[key] : NULL;
+				if (stats != NULL)
+					stats->count = count;
+				continue;
+			}
+			if (stats == NULL || sscanf(line, "%19s", kind) != 1)
+				continue;
+			for (i=0; i<TIME_KINDS; ++i)
+				if (strcmp(kind, statTimeNames[i]) == 0)
+					break;
+			if (i == TIME_KINDS)
+				continue;
+			p = line + strlen(kind);
+			stats->total[i] = strtod(p, &p);
+			for (j=0; j<FSTATS_BUCKETS; ++j)
+				stats->histogram[i][j] = strtol(p, &p, 10);
+		}
 	}
+	fclose(statFyle);
 }
 
   void
 writeFredStats()
 {
-	FILE	*statFyle;
-	int	 i;
-
-	if ((statFyle = fopen("fredStats", "w")) != NULL) {
-		for (i=0; i<128; ++i)
-			putw(fredStats[i], statFyle);
-		fclose(statFyle);
+	FILE		*statFyle;
+	commandStats	*stats;
+	int		 i, j, k;
+
+	if (!statsReadable || (statFyle = fopen("fredStats", "w")) == NULL)
+		return;
+	fprintf(statFyle, "%s %d\n", FSTATS_MAGIC, FSTATS_VERSION);
+	for (i=0; i<FSTATS_KEYS; ++i) {
+		stats = &fredStats[i];
+		if (stats->count == 0)
+			continue;
+		fprintf(statFyle, "key %d %ld\n", i, stats->count);
+		for (j=0; j<TIME_KINDS; ++j) {
+			fprintf(statFyle, "%s %.6f", statTimeNames[j],
+				stats->total[j]);
+			for (k=0; k<FSTATS_BUCKETS; ++k)
+				fprintf(statFyle, " %ld", stats->histogram[j][k]);
+			fprintf(statFyle, "\n");
+		}
 	}
+	fclose(statFyle);
+}
+
+  static void
+recordTime(stats, kind, seconds)
+  commandStats	*stats;
+  statTime	 kind;
+  double	 seconds;
+{
+	int	bucket;
+	double	limit;
+
+	if (seconds < 0.0)
+		seconds = 0.0;
+	for (bucket = 0, limit = 1e-6; seconds >= limit &&
+			bucket < FSTATS_BUCKETS - 1; ++bucket)
+		limit *= 2;
+	stats->total[kind] += seconds;
+	++stats->histogram[kind][bucket];
 }
 
   int
@@ -179,10 +259,10 @@ touchObject()
 {
 	char buf;
 
-	if (!testMode) {
+	if (!gx->testMode) {
 		c64_key_command('t');
-		up(&buf, (word) 1, TOUCHED_OBJECT);
-		Cont();
+		linkUp(&buf, (word) 1, TOUCHED_OBJECT);
+		linkCont();
 		return(buf);
 	} else
 		return(displayNoid);
@@ -288,13 +368,13 @@ showObject(noid)
 	line = 1;
 	col = 0;
 	fieldNum = 1;
-	obj = noidArray[noid];
+	obj = gx->noidArray[noid];
 	getyx(curscr, y, x);
 	clearDisplay();
 	if (obj->class > 1)
-		fieldNum = displayFieldList(classDefs[0]->fields,
+		fieldNum = displayFieldList(gx->classDefs[0]->fields,
 			obj->stateVector, &line, &col, fieldNum);
-	fieldNum = displayFieldList(classDefs[obj->class+1]->fields,
+	fieldNum = displayFieldList(gx->classDefs[obj->class+1]->fields,
 		obj->stateVector, &line, &col, fieldNum);
 	move(y, x);
 	refresh();
@@ -321,7 +401,7 @@ editOneObject(noid)
 				0 : selectedField - 2;
 			lastField = FALSE;
 		} else if (c != '\r' && c != '\n' && c != ' ')
-			revalueField(c, noidArray[noid]->stateVector);
+			revalueField(c, gx->noidArray[noid]->stateVector);
 		++selectedField;
 	} while (!lastField);
 	selectedField = 0;
@@ -334,11 +414,13 @@ editObject()
 	int	y, x;
 
 	echoLine("editing object %d (%s)", displayNoid,
-		classDefs[noidArray[displayNoid]->class+1]->className->name);
+		gx->classDefs[gx->noidArray[displayNoid]->class+1]->className->name);
 	getyx(curscr, y, x);
 	editOneObject(displayNoid);
-	if (changedFlag)
+	if (changedFlag) {
+		noidChanged[displayNoid] = TRUE;
 		uploadRegion();
+	}
 	move(y, x);
 	return(TRUE);
 }
@@ -348,7 +430,7 @@ displayOneObject(noid)
   int	noid;
 {
 	echoLine("object %d (%s)", noid,
-		classDefs[noidArray[noid]->class+1]->className->name);
+		gx->classDefs[gx->noidArray[noid]->class+1]->className->name);
 	showObject(noid);
 }
 
@@ -362,7 +444,7 @@ displayObject()
 		echoLine("aborted");
 	else if (noid < 0 || MAXNOID <= noid)
 		lineError("noid out of range");
-	else if (noidArray[noid] == NULL)
+	else if (gx->noidArray[noid] == NULL)
 		lineError("there is no object #%d", noid);
 	else {
 		displayNoid = noid;
@@ -380,9 +462,9 @@ incDisplayObject()
 
 	count = 0;
 	if (displayNoid == MAXNOID - 1) displayNoid = -1;
-	while (noidArray[++displayNoid] == NULL && ++count < MAXNOID)
+	while (gx->noidArray[++displayNoid] == NULL && ++count < MAXNOID)
 		if (displayNoid == MAXNOID - 1) displayNoid = -1;
-	if (noidArray[displayNoid] != NULL) {
+	if (gx->noidArray[displayNoid] != NULL) {
 		if (displayNoid != 0)
 			c64_touch_command(displayNoid);
 		displayOneObject(displayNoid);
@@ -398,9 +480,9 @@ decDisplayObject()
 
 	count = 0;
 	if (displayNoid == 0) displayNoid = MAXNOID;
-	while (noidArray[--displayNoid] == NULL && ++count < MAXNOID)
+	while (gx->noidArray[--displayNoid] == NULL && ++count < MAXNOID)
 		if (displayNoid == 0) displayNoid = MAXNOID;
-	if (noidArray[displayNoid] != NULL) {
+	if (gx->noidArray[displayNoid] != NULL) {
 		if (displayNoid != 0)
 			c64_touch_command(displayNoid);
 		displayOneObject(displayNoid);
@@ -415,12 +497,10 @@ deleteObject()
 	if (displayNoid == 0)
 		lineError("can't delete the region!");
 	else {
-		if (undeleteBuffer != NULL)
-			freeObject(undeleteBuffer);
-		undeleteBuffer = noidArray[displayNoid];
-		noidArray[displayNoid] = NULL;
-		if (displayNoid == objectCount)
-			--objectCount;
+		freeObject(gx->noidArray[displayNoid]);
+		gx->noidArray[displayNoid] = NULL;
+		if (displayNoid == gx->objectCount)
+			--gx->objectCount;
 		echoLine("object %d is gone", displayNoid);
 		incDisplayObject();
 		uploadRegion();
@@ -428,23 +508,6 @@ deleteObject()
 	return(TRUE);
 }
 
-  boolean
-undeleteObject()
-{
-	int	noid;
-
-	if (undeleteBuffer == NULL)
-		lineError("no deleted object to restore");
-	else {
-		noid = nextFreeNoid();
-		noidArray[noid] = undeleteBuffer;
-		undeleteBuffer = NULL;
-		echoLine("object restored to noid %d", noid);
-		uploadRegion();
-	}
-	return(TRUE);
-}
-
   boolean
 fillFieldPrompt(line, col, aField, buf, editMode)
   int	   line;
@@ -454,8 +517,8 @@ fillFieldPrompt(line, col, aField, buf, editMode)
   boolean  editMode;
 {
 	char	 temp[80];
-	value	*parseBit();
-	value	*parseInt();
+	value	parseBit();
+	value	parseInt();
 	char	*parseString();
 
 	if (aField->invisible)
@@ -497,14 +560,14 @@ generateFredObject(class, twinFlag)
 	int	 noid;
 	int	 i;
 
-	obj = initObject(class, -globalIdCounter++);
+	obj = initObject(class, -gx->globalIdCounter++);
 	if (twinFlag)
-		for (i=4; i<classDefs[class+1]->size; ++i)
+		for (i=4; i<gx->classDefs[class+1]->size; ++i)
 			obj->stateVector[i] =
-				noidArray[displayNoid]->stateVector[i];
+				gx->noidArray[displayNoid]->stateVector[i];
 	noid = nextFreeNoid();
 	displayNoid = noid;
-	noidArray[noid] = obj;
+	gx->noidArray[noid] = obj;
 	clearDisplay();
 	if (twinFlag)
 		displayOneObject(noid);
@@ -526,12 +589,12 @@ createObject()
 		lineError("class value %d is out of range", class);
 	else {
 		echoLine("creating class %d (%s)", class,
-			classDefs[class+1]->className->name);
+			gx->classDefs[class+1]->className->name);
 		previousClass = class;
 		generateFredObject(class, FALSE);
 		uploadRegion();
 		echoLine("created object %d, class %d (%s)", displayNoid,
-			class, classDefs[class+1]->className->name);
+			class, gx->classDefs[class+1]->className->name);
 		c64_touch_command(displayNoid);
 	}
 	return(TRUE);
@@ -545,13 +608,13 @@ twinObject()
 	if (displayNoid == 0)
 		lineError("can't twin region");
 	else {
-		class = noidArray[displayNoid]->class;
+		class = gx->noidArray[displayNoid]->class;
 		previousClass = class;
 		generateFredObject(class, TRUE);
 /*		announceObject(displayNoid, class);*/
 		uploadRegion();
 		echoLine("created object %d, class %d (%s)", displayNoid,
-			class, classDefs[class+1]->className->name);
+			class, gx->classDefs[class+1]->className->name);
 		c64_touch_command(displayNoid);
 	}
 	return(TRUE);
@@ -568,10 +631,10 @@ showNoids()
 	col = 0;
 	getyx(curscr, y, x);
 	clearDisplay();
-	for (i=0; i<objectCount; ++i)
-		if (noidArray[i] != NULL) {
+	for (i=0; i<gx->objectCount; ++i)
+		if (gx->noidArray[i] != NULL) {
 			mvprintw(line, col, "%3d %s", i,
-			   classDefs[noidArray[i]->class+1]->className->name);
+			   gx->classDefs[gx->noidArray[i]->class+1]->className->name);
 			nextlc(line, col, 20);
 		}
 	move(y, x);
@@ -703,19 +766,66 @@ snarfRegion()
 	FILE *fyle;
 
 	c64_override_command(CMD_SAVE_CV);
-	up(buf, (word) 2, CV_SIZE_SLOT);
+	linkUp(buf, (word) 2, CV_SIZE_SLOT);
 	regionSize = buf[0] + buf[1]*256;
-	up(buf, (word)(regionSize), CV_DATA_SLOT);
-	Cont();
+	linkUp(buf, (word)(regionSize), CV_DATA_SLOT);
+	linkCont();
 	p = buf;
 	for (i=0; i<regionSize; ++i)
-		cv[i] = *p++;
+		gx->cv[i] = *p++;
+}
+
+/*
+	Read back the properties of object 'noid' alone.  Reno saves its
+	contents vector as for snarfRegion(), but only the noid table at the
+	front of it is fetched, to find where the object's properties are,
+	and then just those.  Returns FALSE if Reno doesn't have the object.
+ */
+  boolean
+snarfObject(noid)
+  int	noid;
+{
+	byte	buf[2];
+	byte	table[2*MAXNOID + 1];
+	int	regionSize;
+	int	tableSize;
+	int	offset;
+	int	class;
+	int	i;
+
+	c64_override_command(CMD_SAVE_CV);
+	linkUp(buf, (word) 2, CV_SIZE_SLOT);
+	regionSize = buf[0] + buf[1]*256;
+	tableSize = regionSize < sizeof(table) ? regionSize : sizeof(table);
+	linkUp(table, (word) tableSize, CV_DATA_SLOT);
+	for (i=0; i+1 < tableSize && table[i] != 0; i += 2)
+		;
+	offset = i + 1;
+	class = -1;
+	for (i=0; i+1 < tableSize && table[i] != 0; i += 2) {
+		if (table[i] == noid) {
+			class = table[i + 1];
+			break;
+		}
+		offset += cvPropertiesLength(table[i + 1]);
+	}
+	if (class != gx->noidArray[noid]->class || offset +
+			cvPropertiesLength(class) > regionSize) {
+		linkCont();
+		return(FALSE);
+	}
+	linkUp(gx->cv, (word) cvPropertiesLength(class), CV_DATA_SLOT + offset);
+	linkCont();
+	deCvProperties(class, gx->noidArray[noid]->stateVector, 0);
+	return(TRUE);
 }
 
   boolean
 quit()
 {
 	echoLine("quit");
+	finishAutosave();
+	linkWait();
 	clearDisplay();
 	refresh();
 	writeFredStats();
@@ -725,11 +835,13 @@ quit()
   void
 setupFastlinkPort()
 {
-	if (!testMode && !Init(NULL)) {
+	if (!gx->testMode && !Init(NULL)) {
 		error("unable to access device\n");
 		Finish();
 		exit(1);
 	}
+	if (!gx->testMode)
+		startLink();
 }
 
   void
@@ -743,12 +855,11 @@ doFredStuff()
 		strcpy(pathname, pathstr);
 	readFredStats();
 	readPathlist();
-	if (!testMode)
+	if (!gx->testMode)
 		setupFastlinkPort();
 	setupTerminal();
 
 	displayNoid = 0;
-	undeleteBuffer = NULL;
 	previousClass = 2;
 
 	strcpy(regionName, "empty.raw");
@@ -762,9 +873,11 @@ doFredStuff()
   boolean
 initC64editor()
 {
+	linkWait();
 /*	system("down -S < /u0/aric/mic/Gr/all.out");*/
 	system("../down -S < reno.out");
 /*	system("down -S < /u0/chip/reno.out");*/
+	renoHasRegion = FALSE;
 	return(TRUE);
 }
 
@@ -783,6 +896,7 @@ sh()
 	move(1, 0);
 	refresh();
 	echo(); noraw(); nl();
+	linkWait();
 	system(commandBuf);
 	noecho(); raw(); nonl();
 	move(1, 47);
@@ -795,38 +909,58 @@ sh()
   boolean
 loadRegion()
 {
+	char	*autosaveName;
+
 	if (!getRegionName())
 		echoLine("aborted");
-	else if (readRegion() && generateContentsVector()) {
+	else if (readRegion()) {
 		displayRegion();
-		echoLine("loaded %s", regionName);
+		if ((autosaveName = newerAutosave()) != NULL)
+			lineError("loaded %s, but %s is newer", regionName,
+				autosaveName);
+		else
+			echoLine("loaded %s", regionName);
 	}
 	return(TRUE);
 }
 
-  boolean
-saveRaw()
+  static boolean
+saveRawFormat(binary)
+  boolean	binary;
 {
 	if (!getRegionName())
 		echoLine("aborted");
 	else {
-		if (!testMode) {
+		if (!gx->testMode) {
 			snarfRegion();
 			degenerateContentsVector();
 		}
-		if (writeRegionRaw())
-			echoLine("saved raw file %s", regionName);
+		if (writeRegionRaw(binary))
+			echoLine("saved %sraw file %s", binary ? "binary " : "",
+				regionName);
 	}
 	return(TRUE);
 }
 
+  boolean
+saveRaw()
+{
+	return(saveRawFormat(FALSE));
+}
+
+  boolean
+saveBinaryRaw()
+{
+	return(saveRawFormat(TRUE));
+}
+
   boolean
 saveGriddle()
 {
 	if (!getRegionName())
 		echoLine("aborted");
 	else {
-		if (!testMode) {
+		if (!gx->testMode) {
 			snarfRegion();
 			degenerateContentsVector();
 		}
@@ -841,29 +975,64 @@ processCommand()
 {
 	char		c;
 	int		i;
+	boolean		result;
+	struct timespec	start;
+	struct timespec	end;
+	double		elapsed;
+	double		wait;
+	double		emulator;
 	static char	previousC = '\0';
 
 	if (previousC != '\r' && previousC != '\32')
 		addstr(" -- Next?");
 	refresh();
-	c = mygetch();
+	if (scriptMode && !nextScriptCommand())
+		return(quit());
+	c = commandgetch();
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	linkTimes(&wait, &emulator);
+	result = TRUE;
 	for (i=0; commandTable[i].commandKey != '\0'; ++i)
-		if (commandTable[i].commandKey == c) {
-			if (c != '\r' && c != '\32')
-				echoLine(commandTable[i].echoName);
-			fredStats[c]++;
-			previousC = c;
-			return (*(commandTable[i].commandFunction))();
-		}
-	lineError("'%s' is not a Fred command", keyName(c));
+		if (commandTable[i].commandKey == c)
+			break;
+	if (commandTable[i].commandKey != '\0') {
+		if (c != '\r' && c != '\32')
+			echoLine(commandTable[i].echoName);
+		fredStats[c].count++;
+		result = (*(commandTable[i].commandFunction))();
+		journalCommand(c);
+	} else
+		lineError("'%s' is not a Fred command", keyName(c));
 	previousC = c;
-	return(TRUE);
+	/*
+		A script's timings are meant to be compared, so each command
+		is charged for the link traffic it queued.  Interactively that
+		is left to run behind the next keypress.
+	 */
+	if (scriptMode)
+		linkWait();
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	elapsed = (end.tv_sec - start.tv_sec) +
+		(end.tv_nsec - start.tv_nsec) / 1e9;
+	linkTimes(&wait, &emulator);
+	if (commandTable[i].commandKey != '\0') {
+		recordTime(&fredStats[c], TIME_LOCAL, elapsed - wait);
+		recordTime(&fredStats[c], TIME_WAIT, wait);
+		recordTime(&fredStats[c], TIME_EMULATOR, emulator);
+	}
+	autosave(FALSE);
+	if (scriptMode) {
+		printf("%d\t%s\t%.6f\n", scriptLine(), keyName(c), elapsed);
+		fflush(stdout);
+	}
+	return(result);
 }
 
   boolean
 pauseFred()
 {
 	echo(); noraw(); nl();
+	linkWait();
 	kill(0, SIGTSTP);
 	noecho(); raw(); nonl();
 	move(1, 47);
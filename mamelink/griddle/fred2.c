@@ -2,6 +2,11 @@
 #include "griddleDefs.h"
 #include <sys/types.h>
 #include <sys/stat.h>
+#include "fstats.h"
+
+extern commandStats	fredStats[];
+int		pendingch();
+void		uploadRegion();
 
   void
 mydown(buf, len, addr)
@@ -9,172 +14,192 @@ mydown(buf, len, addr)
   word	 len;
   word	 addr;
 {
-	if (!testMode)
-		down(buf, len, addr);
+	if (!gx->testMode)
+		linkDown(buf, len, addr);
 }
 
+/*
+	Load the contents vector into Reno whole, noting which objects it
+	has now so that uploadRegion() can patch them later.
+ */
   void
 displayRegion()
 {
-	mydown(cv, (word)(cvLength), CV_DATA_SLOT);
-	c64_override_command(CMD_LOAD_CV);
-}
+	int	i;
 
-  boolean
-incColorPattern(dp, cmd)
-  int	dp;
-  byte	cmd;
+	mydown(gx->cv, (word)(gx->cvLength), CV_DATA_SLOT);
+	c64_override_command(CMD_LOAD_CV);
+	for (i=0; i < gx->cvLength && gx->cv[i] != 0; i += 2)
+		;
+	memcpy(renoNoids, gx->cv, i);
+	renoNoidsLength = i;
+	renoHasRegion = TRUE;
+	for (i=0; i<MAXNOID; ++i)
+		noidChanged[i] = FALSE;
+}
+
+/*
+	The commands that nudge one property of the display object by a
+	fixed amount.  A run of them typed ahead is applied all at once and
+	sent to Reno as a single patch, rather than one keypress (and one
+	second's wait) each.  A delta of 0 sets the property to 0.
+ */
+typedef struct {
+	char	 key;
+	int	 objectOffset;
+	int	 avatarOffset;
+	int	 delta;
+	int	 mask;
+	char	*complaint;
+} nudge;
+
+static nudge nudges[] = {
+	'p', ORIENT_OFFSET_OBJ, ORIENT_OFFSET_AVA, 8, 0xFF,
+		"region has no color/pattern!",
+	'P', ORIENT_OFFSET_OBJ, ORIENT_OFFSET_AVA, -8, 0xFF,
+		"region has no color/pattern!",
+	'.', X_OFFSET_OBJ, X_OFFSET_AVA, 4, 0xFF,
+		"region has no X-coordinate!",
+	',', X_OFFSET_OBJ, X_OFFSET_AVA, -4, 0xFF,
+		"region has no X-coordinate!",
+	'?', Y_OFFSET_OBJ, Y_OFFSET_AVA, 1, 0xFF,
+		"region has no Y-coordinate!",
+	'/', Y_OFFSET_OBJ, Y_OFFSET_AVA, -1, 0xFF,
+		"region has no Y-coordinate!",
+	'>', Y_OFFSET_OBJ, Y_OFFSET_AVA, 10, 0xFF,
+		"region has no Y-coordinate!",
+	'<', Y_OFFSET_OBJ, Y_OFFSET_AVA, -10, 0xFF,
+		"region has no Y-coordinate!",
+	's', GRSTATE_OFFSET_OBJ, GRSTATE_OFFSET_AVA, 0, 0xFFFF,
+		"region does not have grState!",
+	'S', GRSTATE_OFFSET_OBJ, GRSTATE_OFFSET_AVA, 1, 0xFFFF,
+		"region does not have grState!",
+	'\0', 0, 0, 0, 0, NULL
+};
+
+  static nudge *
+findNudge(key)
+  int	key;
+{
+	int	i;
+
+	for (i=0; nudges[i].key != '\0'; ++i)
+		if (nudges[i].key == key)
+			return(&nudges[i]);
+	return(NULL);
+}
+
+  static void
+applyNudge(n)
+  nudge	*n;
 {
 	byte	*buf;
+	int	 offset;
 
-	if (displayNoid == 0)
-		lineError("region has no color/pattern!");
-	else {
-		buf = noidArray[displayNoid]->stateVector;
-		if (isAvatar(displayNoid))
-			fillWord(buf, ORIENT_OFFSET_AVA,
-			       (getWord(buf, ORIENT_OFFSET_AVA) + dp) & 0xFF);
-		else
-			fillWord(buf, ORIENT_OFFSET_OBJ,
-			       (getWord(buf, ORIENT_OFFSET_OBJ) + dp) & 0xFF);
+	buf = gx->noidArray[displayNoid]->stateVector;
+	offset = isAvatar(displayNoid) ? n->avatarOffset : n->objectOffset;
+	if (n->delta == 0)
+		fillWord(buf, offset, 0);
+	else
+		fillWord(buf, offset, (getWord(buf, offset) + n->delta) &
+			n->mask);
+}
+
+/*
+	Apply nudge command 'cmd' and any more nudges already waiting in the
+	input, then bring Reno up to date.  The first other key met is left
+	for processCommand().
+ */
+  static boolean
+nudgeObject(cmd)
+  char	cmd;
+{
+	nudge	*n;
+	int	 c;
+	int	 count;
+
+	n = findNudge(cmd);
+	if (displayNoid == 0) {
+		lineError(n->complaint);
+		return(TRUE);
+	}
+	applyNudge(n);
+	for (count = 1; (c = pendingch()) != ERR; ++count) {
+		if ((n = findNudge(c)) == NULL) {
+			ungetchar(c);
+			break;
+		}
+		applyNudge(n);
+		fredStats[c & 0x7F].count++;
+	}
+	if (count == 1)
 		c64_key_command(cmd);
-		displayOneObject(displayNoid);
+	else {
+		noidChanged[displayNoid] = TRUE;
+		uploadRegion();
 	}
+	displayOneObject(displayNoid);
 	return(TRUE);
 }
 
   boolean
 incPattern()
 {
-	return(incColorPattern(8, 'p'));
+	return(nudgeObject('p'));
 }
 
   boolean
 decPattern()
 {
-	return(incColorPattern(-8, 'P'));
-}
-
-  boolean
-incX(dx, cmd)
-  int	dx;
-  byte	cmd;
-{
-	byte	*buf;
-
-	if (displayNoid == 0)
-		lineError("region has no X-coordinate!");
-	else {
-		buf = noidArray[displayNoid]->stateVector;
-		if (isAvatar(displayNoid))
-			fillWord(buf, X_OFFSET_AVA,
-				(getWord(buf, X_OFFSET_AVA) + dx) & 0xFF);
-		else
-			fillWord(buf, X_OFFSET_OBJ,
-				(getWord(buf, X_OFFSET_OBJ) + dx) & 0xFF);
-		c64_key_command(cmd);
-		displayOneObject(displayNoid);
-	}
-	return(TRUE);
-}
-
-  boolean
-incY(dy, cmd)
-  int	dy;
-  byte	cmd;
-{
-	byte	*buf;
-
-	if (displayNoid == 0)
-		lineError("region has no Y-coordinate!");
-	else {
-		buf = noidArray[displayNoid]->stateVector;
-		if (isAvatar(displayNoid))
-			fillWord(buf, Y_OFFSET_AVA,
-				(getWord(buf, Y_OFFSET_AVA) + dy) & 0xFF);
-		else
-			fillWord(buf, Y_OFFSET_OBJ,
-				(getWord(buf, Y_OFFSET_OBJ) + dy) & 0xFF);
-		c64_key_command(cmd);
-		displayOneObject(displayNoid);
-	}
-	return(TRUE);
+	return(nudgeObject('P'));
 }
 
   boolean
 incX_4()
 {
-	return(incX(4, '.'));
+	return(nudgeObject('.'));
 }
 
   boolean
 decX_4()
 {
-	return(incX(-4, ','));
+	return(nudgeObject(','));
 }
 
   boolean
 incY_1()
 {
-	return(incY(1, '?'));
+	return(nudgeObject('?'));
 }
 
   boolean
 incY_10()
 {
-	return(incY(10, '>'));
+	return(nudgeObject('>'));
 }
 
   boolean
 decY_1()
 {
-	return(incY(-1, '/'));
+	return(nudgeObject('/'));
 }
 
   boolean
 decY_10()
 {
-	return(incY(-10, '<'));
+	return(nudgeObject('<'));
 }
 
   boolean
 zeroGrState()
 {
-	byte	*buf;
-
-	if (displayNoid == 0)
-		lineError("region does not have grState!");
-	else {
-		buf = noidArray[displayNoid]->stateVector;
-		if (isAvatar(displayNoid))
-			fillWord(buf, GRSTATE_OFFSET_AVA, 0);
-		else
-			fillWord(buf, GRSTATE_OFFSET_OBJ, 0);
-		c64_key_command('s');
-		displayOneObject(displayNoid);
-	}
-	return(TRUE);
+	return(nudgeObject('s'));
 }
 
   boolean
 incGrState()
 {
-	byte	*buf;
-
-	if (displayNoid == 0)
-		lineError("region does not have grState!");
-	else {
-		buf = noidArray[displayNoid]->stateVector;
-		if (isAvatar(displayNoid))
-			fillWord(buf, GRSTATE_OFFSET_AVA,
-				getWord(buf, GRSTATE_OFFSET_AVA) + 1);
-		else
-			fillWord(buf, GRSTATE_OFFSET_OBJ,
-				getWord(buf, GRSTATE_OFFSET_OBJ) + 1);
-		c64_key_command('S');
-		displayOneObject(displayNoid);
-	}
-	return(TRUE);
+	return(nudgeObject('S'));
 }
 
   boolean
@@ -185,7 +210,7 @@ toggleOrient()
 	if (displayNoid == 0)
 		lineError("region does not have displayed orientation!");
 	else {
-		buf = noidArray[displayNoid]->stateVector;
+		buf = gx->noidArray[displayNoid]->stateVector;
 		if (isAvatar(displayNoid))
 			fillWord(buf, ORIENT_OFFSET_AVA,
 				getWord(buf, ORIENT_OFFSET_AVA) ^ 0x01);
@@ -203,11 +228,11 @@ borderToggle()
 {
 	byte	*buf;
 
-	if (noidArray[displayNoid]->class != CLASS_TRAP &&
-			noidArray[displayNoid]->class != CLASS_SUPER_TRAP)
+	if (gx->noidArray[displayNoid]->class != CLASS_TRAP &&
+			gx->noidArray[displayNoid]->class != CLASS_SUPER_TRAP)
 		lineError("current object is not a trapezoid!");
 	else {
-		buf = noidArray[displayNoid]->stateVector;
+		buf = gx->noidArray[displayNoid]->stateVector;
 		fillWord(buf, HEIGHT_OFFSET_TRAP,
 				getWord(buf, HEIGHT_OFFSET_TRAP) ^ 0x80);
 		c64_key_command('B');
@@ -222,12 +247,12 @@ flatChange()
 	byte	*buf;
 	int	 class;
 
-	class = noidArray[displayNoid]->class;
+	class = gx->noidArray[displayNoid]->class;
 	if (class != CLASS_FLAT && class != CLASS_TRAP && class !=
 			CLASS_SUPER_TRAP)
 		lineError("inappropriate object for flat type change!");
 	else {
-		buf = noidArray[displayNoid]->stateVector;
+		buf = gx->noidArray[displayNoid]->stateVector;
 		fillWord(buf, TYPE_OFFSET_FLAT,
 			(getWord(buf, TYPE_OFFSET_FLAT) + 1) & 3);
 		c64_key_command('m');
@@ -244,7 +269,7 @@ foreground()
 	if (displayNoid == 0)
 		lineError("region does not have foreground/background!");
 	else {
-		buf = noidArray[displayNoid]->stateVector;
+		buf = gx->noidArray[displayNoid]->stateVector;
 		if (isAvatar(displayNoid))
 			fillWord(buf, Y_OFFSET_AVA,
 				getWord(buf, Y_OFFSET_AVA) | 0x80);
@@ -265,7 +290,7 @@ background()
 	if (displayNoid == 0)
 		lineError("region does not have foreground/background!");
 	else {
-		buf = noidArray[displayNoid]->stateVector;
+		buf = gx->noidArray[displayNoid]->stateVector;
 		if (isAvatar(displayNoid))
 			fillWord(buf, Y_OFFSET_AVA,
 				getWord(buf, Y_OFFSET_AVA) & 0x7F);
@@ -278,11 +303,62 @@ background()
 	return(TRUE);
 }
 
+/*
+	Whether Reno can take CMD_PATCH_CV.  The reno.prg in mamelink can't,
+	so patches are only sent when $FREDPATCHCV is set.
+ */
+  static boolean
+renoPatches()
+{
+	static int	patches = -1;
+
+	if (patches < 0)
+		patches = getenv("FREDPATCHCV") != NULL;
+	return(patches);
+}
+
+/*
+	Bring Reno up to date after an edit.  If it can take patches and
+	still has the same objects as when the region was last loaded, it is
+	only sent the properties of the objects marked in noidChanged[], each
+	as its noid followed by its contents vector properties, ending with a
+	0, to apply with CMD_PATCH_CV.  Otherwise it gets the whole region
+	again.
+ */
   void
 uploadRegion()
 {
-	generateContentsVector();
-	displayRegion();
+	int	noid;
+	int	start;
+
+	if (!generateContentsVector() || !renoPatches() || !renoHasRegion ||
+			noidChanged[0] ||
+			gx->cvLength <= renoNoidsLength ||
+			gx->cv[renoNoidsLength] != 0 ||
+			memcmp(gx->cv, renoNoids, renoNoidsLength) != 0) {
+		displayRegion();
+		return;
+	}
+	gx->cvLength = 0;
+	for (noid=1; noid<gx->objectCount; ++noid) {
+		if (!noidChanged[noid] || gx->noidArray[noid] == NULL)
+			continue;
+		start = gx->cvLength;
+		cvByte(noid);
+		cvProperties(gx->noidArray[noid]->class,
+			gx->noidArray[noid]->stateVector);
+		if (gx->cvLength == start + 1) {
+			generateContentsVector();
+			displayRegion();
+			return;
+		}
+		noidChanged[noid] = FALSE;
+	}
+	if (gx->cvLength == 0)
+		return;
+	cvByte(0);
+	mydown(gx->cv, (word)(gx->cvLength), CV_DATA_SLOT);
+	c64_override_command(CMD_PATCH_CV);
 }
 
   void
@@ -301,31 +377,323 @@ homogenize(filename)
 	}
 }
 
+#define REGION_CACHE_SIZE	8
+
+/*
+	The last few regions read, as they were when read, so that going
+	back to one skips parsing it and making its contents vector.  An
+	entry is good for as long as its file's size and modification time
+	stay the same.  Neighbours read ahead by the prefetcher (see
+	prefetch.c) go in here too.
+ */
+static cachedRegion	regionCache[REGION_CACHE_SIZE];
+static long		regionCacheClock = 0;
+
+  object *
+copyObject(obj)
+  object	*obj;
+{
+	object	*copy;
+	int	 size;
+
+	if (obj == NULL)
+		return(NULL);
+	size = gx->classDefs[obj->class+1]->size;
+	copy = typeAlloc(object);
+	copy->class = obj->class;
+	copy->stateVector = byteAlloc(size);
+	memcpy(copy->stateVector, obj->stateVector, size);
+	return(copy);
+}
+
+  static cachedRegion *
+findCachedRegion(fileName, statBuf)
+  char		*fileName;
+  struct stat	*statBuf;
+{
+	int	i;
+
+	for (i=0; i<REGION_CACHE_SIZE; ++i)
+		if (regionCache[i].fileName != NULL &&
+				strcmp(regionCache[i].fileName, fileName) == 0 &&
+				regionCache[i].fileTime == statBuf->st_mtime &&
+				regionCache[i].fileSize == statBuf->st_size)
+			return(&regionCache[i]);
+	return(NULL);
+}
+
+/*
+	Make room for region 'fileName', in place of any older copy of the
+	same file or else the least recently used.
+ */
+  static cachedRegion *
+cacheSlot(fileName)
+  char	*fileName;
+{
+	cachedRegion	*entry;
+	int		 i;
+
+	entry = &regionCache[0];
+	for (i=0; i<REGION_CACHE_SIZE; ++i) {
+		if (regionCache[i].fileName != NULL &&
+				strcmp(regionCache[i].fileName, fileName) == 0) {
+			entry = &regionCache[i];
+			break;
+		}
+		if (regionCache[i].lastUsed < entry->lastUsed)
+			entry = &regionCache[i];
+	}
+	if (entry->fileName != NULL) {
+		free(entry->fileName);
+		for (i=0; i<entry->objectCount; ++i)
+			if (entry->objects[i] != NULL)
+				freeObject(entry->objects[i]);
+		entry->fileName = NULL;
+	}
+	return(entry);
+}
+
+/*
+	Remember the region just read and its contents vector.
+ */
+  static void
+cacheRegion(fileName, statBuf, globalIdCounter)
+  char		*fileName;
+  struct stat	*statBuf;
+  int		 globalIdCounter;
+{
+	cachedRegion	*entry;
+	int		 i;
+
+	entry = cacheSlot(fileName);
+	entry->fileName = saveString(fileName);
+	entry->fileTime = statBuf->st_mtime;
+	entry->fileSize = statBuf->st_size;
+	entry->lastUsed = ++regionCacheClock;
+	entry->objectCount = gx->objectCount;
+	entry->globalIdCounter = globalIdCounter;
+	for (i=0; i<gx->objectCount; ++i)
+		entry->objects[i] = copyObject(gx->noidArray[i]);
+	memcpy(entry->cv, gx->cv, gx->cvLength);
+	entry->cvLength = gx->cvLength;
+}
+
+/*
+	Take in the regions the prefetcher has read since last time.
+ */
+  static void
+collectPrefetchedRegions()
+{
+	cachedRegion	*region;
+	cachedRegion	*entry;
+
+	while ((region = takePrefetchedRegion()) != NULL) {
+		entry = cacheSlot(region->fileName);
+		*entry = *region;
+		entry->lastUsed = ++regionCacheClock;
+		free(region);
+	}
+}
+
+  static boolean
+regionIsCached(name)
+  char	*name;
+{
+	char		 fileName[80];
+	char		*key;
+	struct stat	 statBuf;
+	char		*index();
+
+	strcpy(fileName, name);
+	if ((key = index(fileName, '#')) != NULL)
+		*key = '\0';
+	return(stat(fileName, &statBuf) == 0 &&
+		findCachedRegion(name, &statBuf) != NULL);
+}
+
+/*
+	The world index named by FREDWORLD is a file of lines
+		<global ID> <region file name>
+	giving the file each region is in, for finding a region's
+	neighbours.
+ */
+typedef struct {
+	int	 id;
+	char	*name;
+} worldIndexEntry;
+
+static worldIndexEntry	*worldIndex = NULL;
+static int		 worldIndexCount = -1;
+
+  static char *
+worldIndexName(id)
+  int	id;
+{
+	FILE	*fyle;
+	char	 line[200];
+	char	 name[80];
+	int	 n;
+	int	 i;
+
+	if (worldIndexCount < 0) {
+		worldIndexCount = 0;
+		if (getenv("FREDWORLD") != NULL &&
+				(fyle = fopen(getenv("FREDWORLD"), "r")) != NULL) {
+			while (fgets(line, sizeof(line), fyle) != NULL) {
+				if (sscanf(line, "%d %79s", &n, name) != 2)
+					continue;
+				if ((worldIndexCount & 63) == 0)
+					worldIndex = (worldIndexEntry *)realloc(
+						worldIndex, (worldIndexCount +
+						64) * sizeof(worldIndexEntry));
+				worldIndex[worldIndexCount].id = n;
+				worldIndex[worldIndexCount++].name =
+					saveString(name);
+			}
+			fclose(fyle);
+		}
+	}
+	for (i=0; i<worldIndexCount; ++i)
+		if (worldIndex[i].id == id || worldIndex[i].id == -id)
+			return(worldIndex[i].name);
+	return(NULL);
+}
+
+/*
+	Start reading the neighbours of the region just read, which came
+	from 'cacheName', in the background.  A region from an archive finds
+	its neighbours in the same archive by global ID; any other looks
+	them up in the world index.
+ */
+  static void
+prefetchNeighbours(cacheName)
+  char	*cacheName;
+{
+	static int	 offsets[] = {
+		EAST_OFFSET_REG, WEST_OFFSET_REG, NORTH_OFFSET_REG,
+		SOUTH_OFFSET_REG
+	};
+	char		 names[4][80];
+	char		*wantedNames[4];
+	char		*key;
+	char		*file;
+	int		 count;
+	int		 id;
+	int		 i;
+	char		*index();
+
+	if (gx->objectCount == 0 || gx->noidArray[0] == NULL ||
+			gx->noidArray[0]->class != 0)
+		return;
+	count = 0;
+	for (i=0; i<4; ++i) {
+		id = getLong(gx->noidArray[0]->stateVector, offsets[i]);
+		if (id == 0 || id == -1)
+			continue;
+		if ((key = index(cacheName, '#')) != NULL)
+			sprintf(names[count], "%.*s#%d", (int)(key - cacheName),
+				cacheName, id);
+		else if ((file = worldIndexName(id)) != NULL) {
+			sprintf(names[count], "%s%s", pathname, file);
+			homogenize(names[count]);
+		} else
+			continue;
+		if (!regionIsCached(names[count])) {
+			wantedNames[count] = names[count];
+			++count;
+		}
+	}
+	if (count > 0)
+		prefetchRegions(wantedNames, count);
+}
+
+  static void
+restoreCachedRegion(entry)
+  cachedRegion	*entry;
+{
+	int	i;
+
+	resetRegionCounters();
+	for (i=0; i<entry->objectCount; ++i)
+		gx->noidArray[i] = copyObject(entry->objects[i]);
+	gx->objectCount = entry->objectCount;
+	gx->globalIdCounter = entry->globalIdCounter;
+	memcpy(gx->cv, entry->cv, entry->cvLength);
+	gx->cvLength = entry->cvLength;
+	entry->lastUsed = ++regionCacheClock;
+}
+
+/*
+	Read the region and make its contents vector.  A region name of the
+	form file#key loads region 'key' out of the archive 'file' (see
+	archive.c) instead of parsing a region file.
+ */
   boolean
 readRegion()
 {
-	char  regionFileName[80];
-
+	char		 regionFileName[80];
+	char		 cacheName[80];
+	char		*key;
+	byte		*data;
+	int		 length;
+	struct stat	 statBuf;
+	boolean		 haveStat;
+	cachedRegion	*entry;
+	int		 globalIdCounter;
+	char		*index();
+	profilePhase	 phase;
+
+	autosave(TRUE);
 	sprintf(regionFileName, "%s%s", pathname, regionName);
 	homogenize(regionFileName);
-	queueInputFile(saveString(regionFileName));
-	if (openFirstFile(TRUE)) {
+	strcpy(cacheName, regionFileName);
+	if ((key = index(regionFileName, '#')) != NULL)
+		*key++ = '\0';
+	haveStat = stat(regionFileName, &statBuf) == 0;
+	collectPrefetchedRegions();
+	entry = haveStat ? findCachedRegion(cacheName, &statBuf) : NULL;
+	if (entry != NULL) {
+		restoreCachedRegion(entry);
+	} else if (key != NULL) {
+		if (!findArchiveRegion(regionFileName, key, &data, &length)) {
+			lineError("can't find '%s' in '%s'", key,
+				regionFileName);
+			return(FALSE);
+		}
 		resetRegionCounters();
-		yyparse();
-		echoLine("reading %d objects", objectCount);
-		globalIdCounter += objectCount;
-		displayNoid = 0;
-		if (objectCount > 127)
-			lineError("too many objects in region");
-		return(TRUE);
+		loadArchiveRegion(data, length);
 	} else {
-		lineError("can't open '%s'", regionFileName);
-		return(FALSE);
+		queueInputFile(saveString(regionFileName));
+		if (!openFirstFile(TRUE)) {
+			lineError("can't open '%s'", regionFileName);
+			return(FALSE);
+		}
+		resetRegionCounters();
+		phase = PROFILE_ENTER(PHASE_PARSE);
+		yyparse();
+		PROFILE_LEAVE(phase);
 	}
+	echoLine("reading %d objects", gx->objectCount);
+	globalIdCounter = gx->globalIdCounter;
+	gx->globalIdCounter += gx->objectCount;
+	displayNoid = 0;
+	if (gx->objectCount > 127)
+		lineError("too many objects in region");
+	if (entry == NULL) {
+		if (!generateContentsVector())
+			return(FALSE);
+		if (haveStat)
+			cacheRegion(cacheName, &statBuf, globalIdCounter);
+	}
+	resetJournal();
+	startAutosave(cacheName);
+	prefetchNeighbours(cacheName);
+	return(TRUE);
 }
 
   boolean
-writeRegionRaw()
+writeRegionRaw(binary)
+  boolean	binary;
 {
 	char  regionFileName[80];
 	int   i;
@@ -339,11 +707,15 @@ writeRegionRaw()
 				echoLine("write aborted");
 				return(FALSE);
 			}
-	if ((rawFile = fopen(regionFileName, "w")) != NULL) {
-		for (i=0; i<objectCount; ++i)
-			outputRawObject(noidArray[i]);
-		fclose(rawFile);
-		rawFile = NULL;
+	if ((gx->rawFile = fopen(regionFileName, "w")) != NULL) {
+		gx->binaryRaw = binary;
+		gx->rawHeaderWritten = FALSE;
+		beginRawOutput();
+		for (i=0; i<gx->objectCount; ++i)
+			outputRawObject(gx->noidArray[i]);
+		fclose(gx->rawFile);
+		gx->rawFile = NULL;
+		forgetAutosave();
 		return(TRUE);
 	} else {
 		lineError("can't open '%s'", regionFileName);
@@ -366,11 +738,12 @@ writeRegionGriddle()
 				echoLine("write aborted");
 				return(FALSE);
 			}
-	if ((griFile = fopen(regionFileName, "w")) != NULL) {
-		for (i=0; i<objectCount; ++i)
-			dumpObject(noidArray[i]);
-		fclose(griFile);
-		griFile = NULL;
+	if ((gx->griFile = fopen(regionFileName, "w")) != NULL) {
+		for (i=0; i<gx->objectCount; ++i)
+			dumpObject(gx->noidArray[i]);
+		fclose(gx->griFile);
+		gx->griFile = NULL;
+		forgetAutosave();
 		return(TRUE);
 	} else {
 		lineError("can't open '%s'", regionFileName);
@@ -414,11 +787,11 @@ nextFreeNoid()
 {
 	int	noid;
 
-	for (noid=0; noid<objectCount; ++noid)
-		if (noidArray[noid] == NULL)
+	for (noid=0; noid<gx->objectCount; ++noid)
+		if (gx->noidArray[noid] == NULL)
 			break;
-	if (noid == objectCount)
-		++objectCount;
+	if (noid == gx->objectCount)
+		++gx->objectCount;
 	return(noid);
 }
 
@@ -433,7 +806,7 @@ announceObject(noid, class)
 
 	if (class == 0)
 		return;
-	buf = noidArray[noid]->stateVector;
+	buf = gx->noidArray[noid]->stateVector;
 	createPacket[0] = class;
 	createPacket[1] = 0;
 	if (class == 1) {
@@ -535,11 +908,11 @@ changeContainer()
 	c64_touch_command(displayNoid);
 	c64_key_command('C');
 	c64_key_command('r');
-	obuf = noidArray[displayNoid]->stateVector;
-	cbuf = noidArray[newContainer]->stateVector;
-	if (noidArray[newContainer]->class == 0)
+	obuf = gx->noidArray[displayNoid]->stateVector;
+	cbuf = gx->noidArray[newContainer]->stateVector;
+	if (gx->noidArray[newContainer]->class == 0)
 		contCode = 0;
-	else if (noidArray[newContainer]->class == 1)
+	else if (gx->noidArray[newContainer]->class == 1)
 		contCode = 1;
 	else
 		contCode = 2;
@@ -563,8 +936,8 @@ trapEdit()
 {
 	char	c;
 
-	if (noidArray[displayNoid]->class != CLASS_TRAP &&
-			noidArray[displayNoid]->class != CLASS_SUPER_TRAP) {
+	if (gx->noidArray[displayNoid]->class != CLASS_TRAP &&
+			gx->noidArray[displayNoid]->class != CLASS_SUPER_TRAP) {
 		lineError("current object is not a trapezoid!");
 		return(TRUE);
 	}
@@ -595,8 +968,10 @@ trapEdit()
 	}
 	echoLine("done editing trapezoid");
 	c64_key_command(TRAP_EDIT_KEY);
-	snarfRegion();
-	degenerateContentsVector();
+	if (!snarfObject(displayNoid)) {
+		snarfRegion();
+		degenerateContentsVector();
+	}
 	displayOneObject(displayNoid);
 	return(TRUE);
 }
@@ -5,7 +5,36 @@
 static boolean unsavedFlag = FALSE;
 static char unsavedChar;
 
-extern int yylval;
+#define LINK_STATUS_WIDTH	32
+#define LINK_STATUS_INTERVAL	200	/* ms; also the idle poll */
+
+/*
+	fred -s script takes its keys from a script instead of the keyboard,
+	one command to a line:
+
+		<key> [<answer>|<answer>...]
+
+	The key is the command's key.  Each answer is typed in turn at the
+	command's prompts, followed by RETURN.  ^c stands for control-c
+	(^? is DEL, ^^ a plain ^).  Blank lines and lines starting with #
+	are skipped.  A command that asks for more keys than its line has is
+	given ESC, and after MAXSTARVED of those the script is abandoned.
+	The end of the script quits.
+
+	The screen goes to /dev/null.  What fred would have shown on its top
+	line goes to the standard output instead, indented by a tab.  Each
+	command is followed by its line number, key and run time in seconds,
+	separated by tabs.
+ */
+#define MAXSCRIPTLINE	1000
+#define MAXSTARVED	16
+
+static FILE	*scriptFyle = NULL;
+static char	 scriptKeys[MAXSCRIPTLINE];
+static char	*scriptNext = "";
+static int	 scriptLineNumber = 0;
+static int	 scriptStarved = 0;
+
 
   void
 echoLine(char	*fmt, ...)
@@ -21,6 +50,13 @@ echoLine(char	*fmt, ...)
 	va_end(ap);
 
 	refresh();
+	if (scriptMode) {
+		printf("\t");
+		va_start(ap, fmt);
+		vprintf(fmt, ap);
+		va_end(ap);
+		printf("\n");
+	}
 }
 
   void
@@ -37,17 +73,177 @@ lineError(char	*fmt, ...)
 	va_end(ap);
 
 	refresh();
-	putchar('\7');
+	if (scriptMode) {
+		printf("\terror: ");
+		va_start(ap, fmt);
+		vprintf(fmt, ap);
+		va_end(ap);
+		printf("\n");
+	} else
+		putchar('\7');
+}
+
+  void
+openScript(name)
+  char	*name;
+{
+	if (strcmp(name, "-") == 0)
+		scriptFyle = stdin;
+	else if ((scriptFyle = fopen(name, "r")) == NULL)
+		systemError("can't open script %s\n", name);
+	scriptMode = TRUE;
+}
+
+/*
+	Move on to the script's next command.  Returns FALSE at the end of
+	the script.
+ */
+  boolean
+nextScriptCommand()
+{
+	char	 line[MAXSCRIPTLINE];
+	char	*in;
+	char	*out;
+	char	*keyEnd;
+	boolean	 answers;
+
+	do {
+		if (fgets(line, MAXSCRIPTLINE, scriptFyle) == NULL)
+			return(FALSE);
+		++scriptLineNumber;
+		for (in = line + strlen(line); in > line && (in[-1] == '\n' ||
+				in[-1] == '\r'); )
+			*--in = '\0';
+	} while (line[0] == '\0' || line[0] == '#');
+	out = scriptKeys;
+	answers = FALSE;
+	keyEnd = line + (line[0] == '^' && line[1] != '\0' ? 2 : 1);
+	for (in = line; *in != '\0' && out < scriptKeys +
+			MAXSCRIPTLINE - 2; ++in) {
+		if (in == keyEnd) {
+			while (*in == ' ' || *in == '\t')
+				++in;
+			if (*in == '\0')
+				break;
+			answers = TRUE;
+		}
+		if (*in == '^' && in[1] != '\0') {
+			++in;
+			*out++ = *in == '^' ? '^' : *in == '?' ? DEL :
+				*in & 0x1F;
+		} else if (*in == '|' && answers)
+			*out++ = '\r';
+		else
+			*out++ = *in;
+	}
+	if (answers)
+		*out++ = '\r';
+	*out = '\0';
+	scriptNext = scriptKeys;
+	scriptStarved = 0;
+	unsavedFlag = FALSE;
+	return(TRUE);
+}
+
+  int
+scriptLine()
+{
+	return(scriptLineNumber);
+}
+
+/*
+	Show how the link to Reno is getting on at the right of the top
+	line.  Returns FALSE if Reno is not being talked to through the
+	link worker.
+ */
+  static boolean
+showLinkStatus()
+{
+	int	pending;
+	int	busy;
+	int	done;
+	int	x, y;
+
+	if (!linkStatus(&pending, &busy, &done))
+		return(FALSE);
+	getyx(stdscr, y, x);
+	move(0, COLS - LINK_STATUS_WIDTH);
+	clrtoeol();
+	printw("link: %d queued %d busy %d done", pending, busy, done);
+	move(y, x);
+	refresh();
+	return(TRUE);
+}
+
+/*
+	While waiting for a key, keep the link status up to date, and if
+	the key is to be the next command's, see to the autosave too.
+ */
+  static char
+waitch(betweenCommands)
+  boolean	betweenCommands;
+{
+	int	c;
+
+	if (unsavedFlag) {
+		unsavedFlag = FALSE;
+		return(unsavedChar);
+	} else if (scriptMode) {
+		if (*scriptNext != '\0')
+			return(*scriptNext++);
+		if (++scriptStarved > MAXSTARVED) {
+			endwin();
+			fprintf(stderr,
+				"script line %d: command wants more keys\n",
+				scriptLineNumber);
+			exit(1);
+		}
+		return(ESCAPE);
+	} else if (!showLinkStatus() && !betweenCommands)
+		return(getch());
+	timeout(LINK_STATUS_INTERVAL);
+	while ((c = getch()) == ERR) {
+		showLinkStatus();
+		if (betweenCommands)
+			autosave(FALSE);
+	}
+	timeout(-1);
+	return(c);
 }
 
   char
 mygetch()
 {
+	return(waitch(FALSE));
+}
+
+/*
+	Wait for the key of the next command.  Only here, with no command
+	half done, is it safe to autosave while fred sits idle.
+ */
+  char
+commandgetch()
+{
+	return(waitch(TRUE));
+}
+
+/*
+	Like mygetch(), but returns ERR at once if nothing has been typed.
+ */
+  int
+pendingch()
+{
+	int	c;
+
 	if (unsavedFlag) {
 		unsavedFlag = FALSE;
 		return(unsavedChar);
-	} else
-		return(getch());
+	} else if (scriptMode)
+		return(*scriptNext != '\0' ? *scriptNext++ : ERR);
+	nodelay(stdscr, TRUE);
+	c = getch();
+	nodelay(stdscr, FALSE);
+	return(c);
 }
 
   void
@@ -195,33 +391,41 @@ fieldPrompt(line, col, aField, buf, highlight)
 	refresh();
 }
 
-  value *
+/*
+	Strings and bit strings parsed here are kept in the arena, like the
+	values of variables.
+ */
+  value
 parseValue(dataptr)
   char	**dataptr;
 {
 	char	*data;
-	value	*val;
-	value	*buildValue();
+	value	 val;
+	YYSTYPE	 lval;
 	valueType resultType, newType;
 	boolean	 typeTest;
 	int	 sign;
 
 	if (dataptr == NULL || *dataptr == NULL)
 		return(buildValue(VAL_INTEGER, 0));
-	fredLexString = *dataptr;
+	gx->fredLexString = *dataptr;
+	gx->yylval = &lval;
 	resultType = newType = VAL_INTEGER;
-	val = NULL;
+	val.value = 0;
+	val.dataType = VAL_UNDEFINED;
 	sign = 1;
 	for (;;) {
 		typeTest = FALSE;
-		switch (yylex()) {
+		switch (lexToken()) {
 			Case Number:
-				val = buildValue(resultType, yylval*sign);
+				val = buildValue(resultType, lval.number*sign);
 			Case String:
-				val = buildValue(VAL_STRING, yylval);
+				val = keepValue(buildString(lval.string));
+				free(lval.string);
 				typeTest = TRUE;
 			Case BitString:
-				val = buildValue(VAL_BITSTRING, yylval);
+				val = keepValue(buildBitString(lval.bitString));
+				free(lval.bitString);
 				typeTest = TRUE;
 			Case '-':
 				sign = -sign;
@@ -237,7 +441,7 @@ parseValue(dataptr)
 			Case ',':
 				if (resultType != VAL_INTEGER)
 					lineError("dangling type!");
-				*dataptr = fredLexString;
+				*dataptr = gx->fredLexString;
 				return(val);
 			Case 0:
 				if (resultType != VAL_INTEGER)
@@ -246,7 +450,7 @@ parseValue(dataptr)
 				return(val);
 			Default:
 				lineError("syntax error!");
-				if (val == NULL)
+				if (val.dataType == VAL_UNDEFINED)
 					val = buildValue(VAL_INTEGER, 0);
 		}
 		if (typeTest && resultType != VAL_INTEGER)
@@ -256,30 +460,32 @@ parseValue(dataptr)
 	}
 }
 
-  value *
+  value
 parseInt(dataptr)
   char	**dataptr;
 {
-	value	*val;
-	value	*buildNumber();
+	value	val;
 
 	val = parseValue(dataptr);
-	if (val != NULL && !isInteger(val)) {
+	if (val.dataType == VAL_UNDEFINED)
+		val = buildNumber(0);
+	else if (!isInteger(val)) {
 		lineError("invalid data type for integer value!");
 		val = buildNumber(0);
 	}
 	return(val);
 }
 
-  value *
+  value
 parseBit(dataptr)
   char	**dataptr;
 {
-	value	*val;
-	value	*buildNumber();
+	value	val;
 
 	val = parseValue(dataptr);
-	if (val != NULL && !isInteger(val) && val->dataType != VAL_BITSTRING){
+	if (val.dataType == VAL_UNDEFINED)
+		val = buildNumber(0);
+	else if (!isInteger(val) && val.dataType != VAL_BITSTRING) {
 		lineError("invalid data type for bitstring value!");
 		val = buildNumber(0);
 	}
@@ -290,13 +496,13 @@ parseBit(dataptr)
 parseString(dataptr)
   char	**dataptr;
 {
-	value		*val;
+	value		 val;
 
 	if (dataptr == NULL || *dataptr == NULL)
 		return(NULL);
 	val = parseValue(dataptr);
 	if (isString(val))
-		return((char *)(val->value));
+		return((char *)(val.value));
 	else {
 		lineError("invalid data type for string value!");
 		return(NULL);
@@ -338,8 +544,13 @@ WINDOW *clearWindow;
 setupTerminal()
 {
 	WINDOW	*newwin();
+	FILE	*nullFyle;
 
-	initscr();
+	if (!scriptMode)
+		initscr();
+	else if ((nullFyle = fopen("/dev/null", "r+")) == NULL ||
+			newterm("vt100", nullFyle, nullFyle) == NULL)
+		systemError("can't make a screen for the script\n");
 	noecho();
 	raw();
 	nonl();
@@ -0,0 +1,46 @@
+/*
+	fred's command statistics, kept in the file fredStats in the
+	directory fred is run in and reported on by util/dumpfstats.
+
+	For every command key fred counts the keypresses and, for each run of
+	the command, how long it took, split three ways:
+
+		local		time fred spent on its own
+		wait		time fred sat waiting on the link to Reno
+		emulator	settling time the command gave Reno
+
+	Each is kept as a total in seconds and as a histogram of the times of
+	single runs.  Bucket 0 counts runs under a microsecond, and bucket i
+	those from 2^(i-1) up to 2^i microseconds; the last bucket takes
+	everything longer.
+
+	The file is text:
+
+		fredStats 2
+		key <key code> <count>
+		local <total> <bucket 0> ... <bucket FSTATS_BUCKETS-1>
+		wait <total> <buckets>
+		emulator <total> <buckets>
+		key ...
+
+	with a key line and its three time lines for each key used.  A file
+	not starting with the magic line is the original format, a count for
+	each of the 128 keys written with putw().
+ */
+
+#define FSTATS_MAGIC	"fredStats"
+#define FSTATS_VERSION	2
+#define FSTATS_KEYS	128
+#define FSTATS_BUCKETS	32
+
+typedef enum {
+	TIME_LOCAL, TIME_WAIT, TIME_EMULATOR, TIME_KINDS
+} statTime;
+
+typedef struct {
+	long	count;
+	double	total[TIME_KINDS];
+	long	histogram[TIME_KINDS][FSTATS_BUCKETS];
+} commandStats;
+
+static char	*statTimeNames[TIME_KINDS] = { "local", "wait", "emulator" };
@@ -55,7 +55,7 @@
 #define YYSKELETON_NAME "yacc.c"
 
 /* Pure parsers.  */
-#define YYPURE 0
+#define YYPURE 2
 
 /* Push parsers.  */
 #define YYPUSH 0
@@ -69,11 +69,9 @@
 /* First part of user prologue.  */
 #line 1 "griddle.y"
 
-#define DEFINE_EXTERNS
 #include "griddleDefs.h"
-#define YYSTYPE intptr_t
 
-#line 77 "y.tab.c"
+#line 75 "y.tab.c"
 
 # ifndef YY_CAST
 #  ifdef __cplusplus
@@ -196,13 +194,35 @@ extern int yydebug;
 
 /* Value type.  */
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
-typedef int YYSTYPE;
+#line 7 "griddle.y"
+union YYSTYPE
+{
+#line 7 "griddle.y"
+
+	int		 number;
+	char		*string;
+	byte		*bitString;
+	symbol		*name;
+	object		*rawObject;
+	expression	*expr;
+	exprList	*exprs;
+	field		*field;
+	fieldList	*fields;
+	fieldType	 fieldType;
+	objectTail	*tail;
+	property	*property;
+	propertyList	*properties;
+
+#line 217 "y.tab.c"
+
+};
+#line 7 "griddle.y"
+typedef union YYSTYPE YYSTYPE;
 # define YYSTYPE_IS_TRIVIAL 1
 # define YYSTYPE_IS_DECLARED 1
 #endif
 
 
-extern YYSTYPE yylval;
 
 
 int yyparse (void);
@@ -279,6 +299,12 @@ enum yysymbol_kind_t
 typedef enum yysymbol_kind_t yysymbol_kind_t;
 
 
+/* Second part of user prologue.  */
+#line 23 "griddle.y"
+
+int yylex(YYSTYPE *lvalp);
+
+#line 308 "y.tab.c"
 
 
 #ifdef short
@@ -662,15 +688,15 @@ static const yytype_int8 yytranslate[] =
 
 #if YYDEBUG
 /* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
-static const yytype_uint8 yyrline[] =
+static const yytype_int16 yyrline[] =
 {
-       0,    23,    23,    24,    28,    29,    30,    31,    32,    36,
-      43,    50,    57,    61,    68,    72,    79,    83,    90,    94,
-      98,   102,   109,   110,   111,   112,   113,   114,   115,   116,
-     117,   118,   119,   120,   124,   128,   135,   139,   146,   150,
-     157,   164,   168,   175,   179,   183,   187,   191,   195,   199,
-     203,   207,   211,   215,   219,   223,   227,   231,   235,   239,
-     243
+       0,    56,    56,    57,    61,    62,    63,    64,    65,    69,
+      76,    83,    90,    94,   101,   105,   112,   116,   123,   127,
+     131,   135,   142,   143,   144,   145,   146,   147,   148,   149,
+     150,   151,   152,   153,   157,   161,   168,   172,   179,   183,
+     190,   197,   201,   208,   212,   216,   220,   224,   228,   232,
+     236,   240,   244,   248,   252,   256,   260,   264,   268,   272,
+     276
 };
 #endif
 
@@ -1051,13 +1077,6 @@ yydestruct (const char *yymsg,
 }
 
 
-/* Lookahead token kind.  */
-int yychar;
-
-/* The semantic value of the lookahead symbol.  */
-YYSTYPE yylval;
-/* Number of syntax errors so far.  */
-int yynerrs;
 
 
 
@@ -1069,6 +1088,19 @@ int yynerrs;
 int
 yyparse (void)
 {
+/* Lookahead token kind.  */
+int yychar;
+
+
+/* The semantic value of the lookahead symbol.  */
+/* Default value used for initialization, for pacifying older GCCs
+   or non-GCC compilers.  */
+YY_INITIAL_VALUE (static YYSTYPE yyval_default;)
+YYSTYPE yylval YY_INITIAL_VALUE (= yyval_default);
+
+    /* Number of syntax errors so far.  */
+    int yynerrs = 0;
+
     yy_state_fast_t yystate = 0;
     /* Number of tokens to shift before error messages enabled.  */
     int yyerrstatus = 0;
@@ -1221,7 +1253,7 @@ yybackup:
   if (yychar == YYEMPTY)
     {
       YYDPRINTF ((stderr, "Reading a token\n"));
-      yychar = yylex ();
+      yychar = yylex (&yylval);
     }
 
   if (yychar <= YYEOF)
@@ -1309,399 +1341,399 @@ yyreduce:
   switch (yyn)
     {
   case 9: /* rawStatement: Rawline  */
-#line 37 "griddle.y"
+#line 70 "griddle.y"
 {
-	executeRawline(yyvsp[0]);
+	executeRawline((yyvsp[0].rawObject));
 }
-#line 1317 "y.tab.c"
+#line 1349 "y.tab.c"
     break;
 
   case 10: /* assignmentStatement: Name '=' expr  */
-#line 44 "griddle.y"
+#line 77 "griddle.y"
 {
-	executeAssignment(yyvsp[-2], yyvsp[0]);
+	executeAssignment((yyvsp[-2].name), (yyvsp[0].expr));
 }
-#line 1325 "y.tab.c"
+#line 1357 "y.tab.c"
     break;
 
   case 11: /* includeStatement: INCLUDE String  */
-#line 51 "griddle.y"
+#line 84 "griddle.y"
 {
-	executeInclude(yyvsp[0]);
+	executeInclude((yyvsp[0].string));
 }
-#line 1333 "y.tab.c"
+#line 1365 "y.tab.c"
     break;
 
   case 12: /* defineStatement: DEFINE expr String fieldList ENDDEFINE  */
-#line 58 "griddle.y"
+#line 91 "griddle.y"
 {
-	executeDefine(yyvsp[-3], yyvsp[-2], yyvsp[-1]);
+	executeDefine((yyvsp[-3].expr), (yyvsp[-2].string), (yyvsp[-1].fields));
 }
-#line 1341 "y.tab.c"
+#line 1373 "y.tab.c"
     break;
 
   case 13: /* defineStatement: DEFINE expr String ENDDEFINE  */
-#line 62 "griddle.y"
+#line 95 "griddle.y"
 {
-	executeDefine(yyvsp[-2], yyvsp[-1], NULL);
+	executeDefine((yyvsp[-2].expr), (yyvsp[-1].string), NULL);
 }
-#line 1349 "y.tab.c"
+#line 1381 "y.tab.c"
     break;
 
   case 14: /* fieldList: field  */
-#line 69 "griddle.y"
+#line 102 "griddle.y"
 {
-	yyval = buildFieldList(NULL, yyvsp[0]);
+	(yyval.fields) = buildFieldList(NULL, (yyvsp[0].field));
 }
-#line 1357 "y.tab.c"
+#line 1389 "y.tab.c"
     break;
 
   case 15: /* fieldList: fieldList field  */
-#line 73 "griddle.y"
+#line 106 "griddle.y"
 {
-	yyval = buildFieldList(yyvsp[-1], yyvsp[0]);
+	(yyval.fields) = buildFieldList((yyvsp[-1].fields), (yyvsp[0].field));
 }
-#line 1365 "y.tab.c"
+#line 1397 "y.tab.c"
     break;
 
   case 16: /* field: basicField  */
-#line 80 "griddle.y"
+#line 113 "griddle.y"
 {
-	yyval = yyvsp[0];
+	(yyval.field) = (yyvsp[0].field);
 }
-#line 1373 "y.tab.c"
+#line 1405 "y.tab.c"
     break;
 
   case 17: /* field: '#' basicField  */
-#line 84 "griddle.y"
+#line 117 "griddle.y"
 {
-	yyval = invisifyField(yyvsp[0]);
+	(yyval.field) = invisifyField((yyvsp[0].field));
 }
-#line 1381 "y.tab.c"
+#line 1413 "y.tab.c"
     break;
 
   case 18: /* basicField: Name ':' fieldType  */
-#line 91 "griddle.y"
+#line 124 "griddle.y"
 {
-	yyval = buildField(yyvsp[-2], buildExprI(NUM_EXPR, 1), yyvsp[0], NULL);
+	(yyval.field) = buildField((yyvsp[-2].name), buildNumberExpr(1), (yyvsp[0].fieldType), NULL);
 }
-#line 1389 "y.tab.c"
+#line 1421 "y.tab.c"
     break;
 
   case 19: /* basicField: Name '(' expr ')' ':' fieldType  */
-#line 95 "griddle.y"
+#line 128 "griddle.y"
 {
-	yyval = buildField(yyvsp[-5], yyvsp[-3], yyvsp[0], NULL);
+	(yyval.field) = buildField((yyvsp[-5].name), (yyvsp[-3].expr), (yyvsp[0].fieldType), NULL);
 }
-#line 1397 "y.tab.c"
+#line 1429 "y.tab.c"
     break;
 
   case 20: /* basicField: Name ':' fieldType '=' exprList  */
-#line 99 "griddle.y"
+#line 132 "griddle.y"
 {
-	yyval = buildField(yyvsp[-4], buildExprI(NUM_EXPR, 1), yyvsp[-2], yyvsp[0]);
+	(yyval.field) = buildField((yyvsp[-4].name), buildNumberExpr(1), (yyvsp[-2].fieldType), (yyvsp[0].exprs));
 }
-#line 1405 "y.tab.c"
+#line 1437 "y.tab.c"
     break;
 
   case 21: /* basicField: Name '(' expr ')' ':' fieldType '=' exprList  */
-#line 103 "griddle.y"
+#line 136 "griddle.y"
 {
-	yyval = buildField(yyvsp[-7], yyvsp[-5], yyvsp[-2], yyvsp[0]);
+	(yyval.field) = buildField((yyvsp[-7].name), (yyvsp[-5].expr), (yyvsp[-2].fieldType), (yyvsp[0].exprs));
 }
-#line 1413 "y.tab.c"
+#line 1445 "y.tab.c"
     break;
 
   case 22: /* fieldType: CHARACTER  */
-#line 109 "griddle.y"
-                                { yyval = (int) FIELD_CHARACTER;	}
-#line 1419 "y.tab.c"
+#line 142 "griddle.y"
+                                { (yyval.fieldType) = FIELD_CHARACTER;	}
+#line 1451 "y.tab.c"
     break;
 
   case 23: /* fieldType: BIN15  */
-#line 110 "griddle.y"
-                                { yyval = (int) FIELD_BIN15;	}
-#line 1425 "y.tab.c"
+#line 143 "griddle.y"
+                                { (yyval.fieldType) = FIELD_BIN15;	}
+#line 1457 "y.tab.c"
     break;
 
   case 24: /* fieldType: BIN31  */
-#line 111 "griddle.y"
-                                { yyval = (int) FIELD_BIN31;	}
-#line 1431 "y.tab.c"
+#line 144 "griddle.y"
+                                { (yyval.fieldType) = FIELD_BIN31;	}
+#line 1463 "y.tab.c"
     break;
 
   case 25: /* fieldType: BIT  */
-#line 112 "griddle.y"
-                                { yyval = (int) FIELD_BIT;		}
-#line 1437 "y.tab.c"
+#line 145 "griddle.y"
+                                { (yyval.fieldType) = FIELD_BIT;		}
+#line 1469 "y.tab.c"
     break;
 
   case 26: /* fieldType: WORDS  */
-#line 113 "griddle.y"
-                                { yyval = (int) FIELD_WORDS;	}
-#line 1443 "y.tab.c"
+#line 146 "griddle.y"
+                                { (yyval.fieldType) = FIELD_WORDS;	}
+#line 1475 "y.tab.c"
     break;
 
   case 27: /* fieldType: REGID  */
-#line 114 "griddle.y"
-                                { yyval = (int) FIELD_REGID;	}
-#line 1449 "y.tab.c"
+#line 147 "griddle.y"
+                                { (yyval.fieldType) = FIELD_REGID;	}
+#line 1481 "y.tab.c"
     break;
 
   case 28: /* fieldType: OBJID  */
-#line 115 "griddle.y"
-                                { yyval = (int) FIELD_OBJID;	}
-#line 1455 "y.tab.c"
+#line 148 "griddle.y"
+                                { (yyval.fieldType) = FIELD_OBJID;	}
+#line 1487 "y.tab.c"
     break;
 
   case 29: /* fieldType: AVAID  */
-#line 116 "griddle.y"
-                                { yyval = (int) FIELD_AVAID;	}
-#line 1461 "y.tab.c"
+#line 149 "griddle.y"
+                                { (yyval.fieldType) = FIELD_AVAID;	}
+#line 1493 "y.tab.c"
     break;
 
   case 30: /* fieldType: FATWORD  */
-#line 117 "griddle.y"
-                                { yyval = (int) FIELD_FATWORD;	}
-#line 1467 "y.tab.c"
+#line 150 "griddle.y"
+                                { (yyval.fieldType) = FIELD_FATWORD;	}
+#line 1499 "y.tab.c"
     break;
 
   case 31: /* fieldType: ENTITY  */
-#line 118 "griddle.y"
-                                { yyval = (int) FIELD_ENTITY;	}
-#line 1473 "y.tab.c"
+#line 151 "griddle.y"
+                                { (yyval.fieldType) = FIELD_ENTITY;	}
+#line 1505 "y.tab.c"
     break;
 
   case 32: /* fieldType: BYTE  */
-#line 119 "griddle.y"
-                                { yyval = (int) FIELD_BYTE;	}
-#line 1479 "y.tab.c"
+#line 152 "griddle.y"
+                                { (yyval.fieldType) = FIELD_BYTE;	}
+#line 1511 "y.tab.c"
     break;
 
   case 33: /* fieldType: VARSTRING  */
-#line 120 "griddle.y"
-                                { yyval = (int) FIELD_VARSTRING;	}
-#line 1485 "y.tab.c"
+#line 153 "griddle.y"
+                                { (yyval.fieldType) = FIELD_VARSTRING;	}
+#line 1517 "y.tab.c"
     break;
 
   case 34: /* objectUseStatement: USE Name Name objectTail  */
-#line 125 "griddle.y"
+#line 158 "griddle.y"
 {
-	executeUse(yyvsp[-2], yyvsp[-1], yyvsp[0]);
+	executeUse((yyvsp[-2].name), (yyvsp[-1].name), (yyvsp[0].tail));
 }
-#line 1493 "y.tab.c"
+#line 1525 "y.tab.c"
     break;
 
   case 35: /* objectUseStatement: USE Name objectTail  */
-#line 129 "griddle.y"
+#line 162 "griddle.y"
 {
-	executeUse(yyvsp[-1], NULL, yyvsp[0]);
+	executeUse((yyvsp[-1].name), NULL, (yyvsp[0].tail));
 }
-#line 1501 "y.tab.c"
+#line 1533 "y.tab.c"
     break;
 
   case 36: /* objectTail: '=' expr '{' properties '}'  */
-#line 136 "griddle.y"
+#line 169 "griddle.y"
 {
-	yyval = buildObjectTail(yyvsp[-3], yyvsp[-1]);
+	(yyval.tail) = buildObjectTail((yyvsp[-3].expr), (yyvsp[-1].properties));
 }
-#line 1509 "y.tab.c"
+#line 1541 "y.tab.c"
     break;
 
   case 37: /* objectTail: '{' properties '}'  */
-#line 140 "griddle.y"
+#line 173 "griddle.y"
 {
-	yyval = buildObjectTail(NULL, yyvsp[-1]);
+	(yyval.tail) = buildObjectTail(NULL, (yyvsp[-1].properties));
 }
-#line 1517 "y.tab.c"
+#line 1549 "y.tab.c"
     break;
 
   case 38: /* properties: property  */
-#line 147 "griddle.y"
+#line 180 "griddle.y"
 {
-	yyval = buildPropertyList(NULL, yyvsp[0]);
+	(yyval.properties) = buildPropertyList(NULL, (yyvsp[0].property));
 }
-#line 1525 "y.tab.c"
+#line 1557 "y.tab.c"
     break;
 
   case 39: /* properties: properties property  */
-#line 151 "griddle.y"
+#line 184 "griddle.y"
 {
-	yyval = buildPropertyList(yyvsp[-1], yyvsp[0]);
+	(yyval.properties) = buildPropertyList((yyvsp[-1].properties), (yyvsp[0].property));
 }
-#line 1533 "y.tab.c"
+#line 1565 "y.tab.c"
     break;
 
   case 40: /* property: Name ':' exprList  */
-#line 158 "griddle.y"
+#line 191 "griddle.y"
 {
-	yyval = buildProperty(yyvsp[-2], yyvsp[0]);
+	(yyval.property) = buildProperty((yyvsp[-2].name), (yyvsp[0].exprs));
 }
-#line 1541 "y.tab.c"
+#line 1573 "y.tab.c"
     break;
 
   case 41: /* exprList: expr  */
-#line 165 "griddle.y"
+#line 198 "griddle.y"
 {
-	yyval = buildExprList(NULL, yyvsp[0]);
+	(yyval.exprs) = buildExprList(NULL, (yyvsp[0].expr));
 }
-#line 1549 "y.tab.c"
+#line 1581 "y.tab.c"
     break;
 
   case 42: /* exprList: exprList ',' expr  */
-#line 169 "griddle.y"
+#line 202 "griddle.y"
 {
-	yyval = buildExprList(yyvsp[-2], yyvsp[0]);
+	(yyval.exprs) = buildExprList((yyvsp[-2].exprs), (yyvsp[0].expr));
 }
-#line 1557 "y.tab.c"
+#line 1589 "y.tab.c"
     break;
 
   case 43: /* expr: Name  */
-#line 176 "griddle.y"
+#line 209 "griddle.y"
 {
-	yyval = buildExprP(ID_EXPR, yyvsp[0]);
+	(yyval.expr) = buildNameExpr((yyvsp[0].name));
 }
-#line 1565 "y.tab.c"
+#line 1597 "y.tab.c"
     break;
 
   case 44: /* expr: Number  */
-#line 180 "griddle.y"
+#line 213 "griddle.y"
 {
-	yyval = buildExprI(NUM_EXPR, yyvsp[0]);
+	(yyval.expr) = buildNumberExpr((yyvsp[0].number));
 }
-#line 1573 "y.tab.c"
+#line 1605 "y.tab.c"
     break;
 
   case 45: /* expr: String  */
-#line 184 "griddle.y"
+#line 217 "griddle.y"
 {
-	yyval = buildExprP(STRING_EXPR, yyvsp[0]);
+	(yyval.expr) = buildStringExpr((yyvsp[0].string));
 }
-#line 1581 "y.tab.c"
+#line 1613 "y.tab.c"
     break;
 
   case 46: /* expr: BitString  */
-#line 188 "griddle.y"
+#line 221 "griddle.y"
 {
-	yyval = buildExprP(BITSTRING_EXPR, yyvsp[0]);
+	(yyval.expr) = buildBitStringExpr((yyvsp[0].bitString));
 }
-#line 1589 "y.tab.c"
+#line 1621 "y.tab.c"
     break;
 
   case 47: /* expr: '(' expr ')'  */
-#line 192 "griddle.y"
+#line 225 "griddle.y"
 {
-	yyval = buildExprP(EXPR_EXPR, yyvsp[-1]);
+	(yyval.expr) = buildOperExpr(EXPR_EXPR, 0, (yyvsp[-1].expr), NULL);
 }
-#line 1597 "y.tab.c"
+#line 1629 "y.tab.c"
     break;
 
   case 48: /* expr: SUB expr  */
-#line 196 "griddle.y"
+#line 229 "griddle.y"
 {
-	yyval = buildExprIP(UNOP_EXPR, UMINUS, yyvsp[0]);
+	(yyval.expr) = buildOperExpr(UNOP_EXPR, UMINUS, (yyvsp[0].expr), NULL);
 }
-#line 1605 "y.tab.c"
+#line 1637 "y.tab.c"
     break;
 
   case 49: /* expr: NOT expr  */
-#line 200 "griddle.y"
+#line 233 "griddle.y"
 {
-	yyval = buildExprIP(UNOP_EXPR, NOT, yyvsp[0]);
+	(yyval.expr) = buildOperExpr(UNOP_EXPR, NOT, (yyvsp[0].expr), NULL);
 }
-#line 1613 "y.tab.c"
+#line 1645 "y.tab.c"
     break;
 
   case 50: /* expr: A expr  */
-#line 204 "griddle.y"
+#line 237 "griddle.y"
 {
-	yyval = buildExprIP(UNOP_EXPR, A, yyvsp[0]);
+	(yyval.expr) = buildOperExpr(UNOP_EXPR, A, (yyvsp[0].expr), NULL);
 }
-#line 1621 "y.tab.c"
+#line 1653 "y.tab.c"
     break;
 
   case 51: /* expr: O expr  */
-#line 208 "griddle.y"
+#line 241 "griddle.y"
 {
-	yyval = buildExprIP(UNOP_EXPR, O, yyvsp[0]);
+	(yyval.expr) = buildOperExpr(UNOP_EXPR, O, (yyvsp[0].expr), NULL);
 }
-#line 1629 "y.tab.c"
+#line 1661 "y.tab.c"
     break;
 
   case 52: /* expr: R expr  */
-#line 212 "griddle.y"
+#line 245 "griddle.y"
 {
-	yyval = buildExprIP(UNOP_EXPR, R, yyvsp[0]);
+	(yyval.expr) = buildOperExpr(UNOP_EXPR, R, (yyvsp[0].expr), NULL);
 }
-#line 1637 "y.tab.c"
+#line 1669 "y.tab.c"
     break;
 
   case 53: /* expr: expr ADD expr  */
-#line 216 "griddle.y"
+#line 249 "griddle.y"
 {
-	yyval = buildExprPIP(BIN_EXPR, yyvsp[-2], ADD, yyvsp[0]);
+	(yyval.expr) = buildOperExpr(BIN_EXPR, ADD, (yyvsp[-2].expr), (yyvsp[0].expr));
 }
-#line 1645 "y.tab.c"
+#line 1677 "y.tab.c"
     break;
 
   case 54: /* expr: expr SUB expr  */
-#line 220 "griddle.y"
+#line 253 "griddle.y"
 {
-	yyval = buildExprPIP(BIN_EXPR, yyvsp[-2], SUB, yyvsp[0]);
+	(yyval.expr) = buildOperExpr(BIN_EXPR, SUB, (yyvsp[-2].expr), (yyvsp[0].expr));
 }
-#line 1653 "y.tab.c"
+#line 1685 "y.tab.c"
     break;
 
   case 55: /* expr: expr MUL expr  */
-#line 224 "griddle.y"
+#line 257 "griddle.y"
 {
-	yyval = buildExprPIP(BIN_EXPR, yyvsp[-2], MUL, yyvsp[0]);
+	(yyval.expr) = buildOperExpr(BIN_EXPR, MUL, (yyvsp[-2].expr), (yyvsp[0].expr));
 }
-#line 1661 "y.tab.c"
+#line 1693 "y.tab.c"
     break;
 
   case 56: /* expr: expr DIV expr  */
-#line 228 "griddle.y"
+#line 261 "griddle.y"
 {
-	yyval = buildExprPIP(BIN_EXPR, yyvsp[-2], DIV, yyvsp[0]);
+	(yyval.expr) = buildOperExpr(BIN_EXPR, DIV, (yyvsp[-2].expr), (yyvsp[0].expr));
 }
-#line 1669 "y.tab.c"
+#line 1701 "y.tab.c"
     break;
 
   case 57: /* expr: expr MOD expr  */
-#line 232 "griddle.y"
+#line 265 "griddle.y"
 {
-	yyval = buildExprPIP(BIN_EXPR, yyvsp[-2], MOD, yyvsp[0]);
+	(yyval.expr) = buildOperExpr(BIN_EXPR, MOD, (yyvsp[-2].expr), (yyvsp[0].expr));
 }
-#line 1677 "y.tab.c"
+#line 1709 "y.tab.c"
     break;
 
   case 58: /* expr: expr AND expr  */
-#line 236 "griddle.y"
+#line 269 "griddle.y"
 {
-	yyval = buildExprPIP(BIN_EXPR, yyvsp[-2], AND, yyvsp[0]);
+	(yyval.expr) = buildOperExpr(BIN_EXPR, AND, (yyvsp[-2].expr), (yyvsp[0].expr));
 }
-#line 1685 "y.tab.c"
+#line 1717 "y.tab.c"
     break;
 
   case 59: /* expr: expr OR expr  */
-#line 240 "griddle.y"
+#line 273 "griddle.y"
 {
-	yyval = buildExprPIP(BIN_EXPR, yyvsp[-2], OR, yyvsp[0]);
+	(yyval.expr) = buildOperExpr(BIN_EXPR, OR, (yyvsp[-2].expr), (yyvsp[0].expr));
 }
-#line 1693 "y.tab.c"
+#line 1725 "y.tab.c"
     break;
 
   case 60: /* expr: expr XOR expr  */
-#line 244 "griddle.y"
+#line 277 "griddle.y"
 {
-	yyval = buildExprPIP(BIN_EXPR, yyvsp[-2], XOR, yyvsp[0]);
+	(yyval.expr) = buildOperExpr(BIN_EXPR, XOR, (yyvsp[-2].expr), (yyvsp[0].expr));
 }
-#line 1701 "y.tab.c"
+#line 1733 "y.tab.c"
     break;
 
 
-#line 1705 "y.tab.c"
+#line 1737 "y.tab.c"
 
       default: break;
     }
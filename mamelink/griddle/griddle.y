@@ -1,10 +1,34 @@
 %{
-#define DEFINE_EXTERNS
 #include "griddleDefs.h"
-#define YYSTYPE intptr_t
 %}
 
-%token Name Number String BitString Rawline
+%define api.pure full
+
+%union YYSTYPE {
+	int		 number;
+	char		*string;
+	byte		*bitString;
+	symbol		*name;
+	object		*rawObject;
+	expression	*expr;
+	exprList	*exprs;
+	field		*field;
+	fieldList	*fields;
+	fieldType	 fieldType;
+	objectTail	*tail;
+	property	*property;
+	propertyList	*properties;
+}
+
+%{
+int yylex(YYSTYPE *lvalp);
+%}
+
+%token <name>		Name
+%token <number>		Number
+%token <string>		String
+%token <bitString>	BitString
+%token <rawObject>	Rawline
 %token INCLUDE DEFINE ENDDEFINE USE
 %token AVAID BIN15 BIN31 BIT BYTE CHARACTER ENTITY FATWORD OBJID REGID
 %token VARSTRING WORDS
@@ -17,6 +41,15 @@
 %left MUL DIV MOD
 %right UMINUS NOT
 
+%type <expr>		expr
+%type <exprs>		exprList
+%type <field>		field basicField
+%type <fields>		fieldList
+%type <fieldType>	fieldType
+%type <tail>		objectTail
+%type <property>	property
+%type <properties>	properties
+
 %%
 
 statementList:
@@ -89,7 +122,7 @@ field:
 basicField:
 		Name ':' fieldType
 {
-	$$ = buildField($1, buildExprI(NUM_EXPR, 1), $3, NULL);
+	$$ = buildField($1, buildNumberExpr(1), $3, NULL);
 }
  |		Name '(' expr ')' ':' fieldType
 {
@@ -97,7 +130,7 @@ basicField:
 }
  |		Name ':' fieldType '=' exprList
 {
-	$$ = buildField($1, buildExprI(NUM_EXPR, 1), $3, $5);
+	$$ = buildField($1, buildNumberExpr(1), $3, $5);
 }
  |		Name '(' expr ')' ':' fieldType '=' exprList
 {
@@ -106,18 +139,18 @@ basicField:
  ;
 
 fieldType:
-		CHARACTER	{ $$ = (int) FIELD_CHARACTER;	}
- |		BIN15		{ $$ = (int) FIELD_BIN15;	}
- |		BIN31		{ $$ = (int) FIELD_BIN31;	}
- |		BIT		{ $$ = (int) FIELD_BIT;		}
- |		WORDS		{ $$ = (int) FIELD_WORDS;	}
- |		REGID		{ $$ = (int) FIELD_REGID;	}
- |		OBJID		{ $$ = (int) FIELD_OBJID;	}
- |		AVAID		{ $$ = (int) FIELD_AVAID;	}
- |		FATWORD		{ $$ = (int) FIELD_FATWORD;	}
- |		ENTITY		{ $$ = (int) FIELD_ENTITY;	}
- |		BYTE		{ $$ = (int) FIELD_BYTE;	}
- |		VARSTRING	{ $$ = (int) FIELD_VARSTRING;	}
+		CHARACTER	{ $$ = FIELD_CHARACTER;	}
+ |		BIN15		{ $$ = FIELD_BIN15;	}
+ |		BIN31		{ $$ = FIELD_BIN31;	}
+ |		BIT		{ $$ = FIELD_BIT;		}
+ |		WORDS		{ $$ = FIELD_WORDS;	}
+ |		REGID		{ $$ = FIELD_REGID;	}
+ |		OBJID		{ $$ = FIELD_OBJID;	}
+ |		AVAID		{ $$ = FIELD_AVAID;	}
+ |		FATWORD		{ $$ = FIELD_FATWORD;	}
+ |		ENTITY		{ $$ = FIELD_ENTITY;	}
+ |		BYTE		{ $$ = FIELD_BYTE;	}
+ |		VARSTRING	{ $$ = FIELD_VARSTRING;	}
  ;
 
 objectUseStatement:
@@ -174,74 +207,74 @@ exprList:
 expr:
 		Name
 {
-	$$ = buildExprP(ID_EXPR, $1);
+	$$ = buildNameExpr($1);
 }
  |		Number
 {
-	$$ = buildExprI(NUM_EXPR, $1);
+	$$ = buildNumberExpr($1);
 }
  |		String
 {
-	$$ = buildExprP(STRING_EXPR, $1);
+	$$ = buildStringExpr($1);
 }
  |		BitString
 {
-	$$ = buildExprP(BITSTRING_EXPR, $1);
+	$$ = buildBitStringExpr($1);
 }
  |		'(' expr ')'
 {
-	$$ = buildExprP(EXPR_EXPR, $2);
+	$$ = buildOperExpr(EXPR_EXPR, 0, $2, NULL);
 }
  |		SUB expr	%prec UMINUS
 {
-	$$ = buildExprIP(UNOP_EXPR, UMINUS, $2);
+	$$ = buildOperExpr(UNOP_EXPR, UMINUS, $2, NULL);
 }
  |		NOT expr
 {
-	$$ = buildExprIP(UNOP_EXPR, NOT, $2);
+	$$ = buildOperExpr(UNOP_EXPR, NOT, $2, NULL);
 }
  |		A expr
 {
-	$$ = buildExprIP(UNOP_EXPR, A, $2);
+	$$ = buildOperExpr(UNOP_EXPR, A, $2, NULL);
 }
  |		O expr
 {
-	$$ = buildExprIP(UNOP_EXPR, O, $2);
+	$$ = buildOperExpr(UNOP_EXPR, O, $2, NULL);
 }
  |		R expr
 {
-	$$ = buildExprIP(UNOP_EXPR, R, $2);
+	$$ = buildOperExpr(UNOP_EXPR, R, $2, NULL);
 }
  |		expr ADD expr
 {
-	$$ = buildExprPIP(BIN_EXPR, $1, ADD, $3);
+	$$ = buildOperExpr(BIN_EXPR, ADD, $1, $3);
 }
  |		expr SUB expr
 {
-	$$ = buildExprPIP(BIN_EXPR, $1, SUB, $3);
+	$$ = buildOperExpr(BIN_EXPR, SUB, $1, $3);
 }
  |		expr MUL expr
 {
-	$$ = buildExprPIP(BIN_EXPR, $1, MUL, $3);
+	$$ = buildOperExpr(BIN_EXPR, MUL, $1, $3);
 }
  |		expr DIV expr
 {
-	$$ = buildExprPIP(BIN_EXPR, $1, DIV, $3);
+	$$ = buildOperExpr(BIN_EXPR, DIV, $1, $3);
 }
  |		expr MOD expr
 {
-	$$ = buildExprPIP(BIN_EXPR, $1, MOD, $3);
+	$$ = buildOperExpr(BIN_EXPR, MOD, $1, $3);
 }
  |		expr AND expr
 {
-	$$ = buildExprPIP(BIN_EXPR, $1, AND, $3);
+	$$ = buildOperExpr(BIN_EXPR, AND, $1, $3);
 }
  |		expr OR expr
 {
-	$$ = buildExprPIP(BIN_EXPR, $1, OR, $3);
+	$$ = buildOperExpr(BIN_EXPR, OR, $1, $3);
 }
  |		expr XOR expr
 {
-	$$ = buildExprPIP(BIN_EXPR, $1, XOR, $3);
+	$$ = buildOperExpr(BIN_EXPR, XOR, $1, $3);
 }
  ;
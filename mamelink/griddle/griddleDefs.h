@@ -3,6 +3,8 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#include <time.h>
+#include <setjmp.h>
 
 #define Case		break; case
 #define Default		break; default
@@ -78,12 +80,30 @@ typedef enum {
 	VAL_REGION, VAL_BITSTRING
 } valueType;
 
-// TODO: Nope, this absolutely does not work
-typedef struct {
-	exprType	type;
-	intptr_t	part1;
-	intptr_t	part2;
-	intptr_t	part3;
+typedef enum {
+	PHASE_OTHER, PHASE_LEX, PHASE_PARSE, PHASE_EVALUATE, PHASE_FILL,
+	PHASE_SHIFT, PHASE_SORT, PHASE_OUTPUT, PHASE_CV, PHASE_COUNT
+} profilePhase;
+
+/*
+	Expression nodes come out of a per-context pool (newExpr() in
+	build.c) and go back to it through freeExpr().  'oper' is the token
+	of a UNOP_EXPR or BIN_EXPR, and the valueType of a NUM_EXPR, which
+	need not be VAL_INTEGER once foldExpr() has been at it.  'operand'
+	is the only operand of an EXPR_EXPR or UNOP_EXPR and the left one of
+	a BIN_EXPR.
+ */
+typedef struct expressionStruct {
+	exprType			 type;
+	int				 oper;
+	union {
+		struct symbolStruct	*name;
+		int			 number;
+		char			*string;
+		byte			*bitString;
+		struct expressionStruct	*operand;
+	}				 part;
+	struct expressionStruct		*right;
 } expression;
 
 typedef struct exprListStruct {
@@ -96,8 +116,13 @@ typedef struct stringListStruct {
 	struct stringListStruct	*nextString;
 } stringList;
 
+/*
+	Values are passed around by value.  A string or bit string value
+	points at storage it does not own: the expression it was evaluated
+	from, or the context's arena once it is a variable's value.
+ */
 typedef struct {
-	int			 value;
+	intptr_t		 value;		/* int, or string pointer */
 	valueType		 dataType;
 } value;
 
@@ -137,7 +162,7 @@ typedef struct symbolStruct {
 	int			 codeNumber;
 	symbolType		 type;
 	union {
-		value			*value;
+		value			 value;
 		expression		*expr;
 		objectStub		*object;
 		int			 class;
@@ -188,62 +213,64 @@ typedef struct {
 #endif
 
 #define  HASH_MAX	512
-EXTERN symbol	*symbolTable[HASH_MAX];
 
 #define typeAlloc(t) ((t *)malloc(sizeof(t)))
 #define typeAllocMulti(t,n) ((t *)malloc((n)*sizeof(t)))
 #define byteAlloc(n) ((byte *)malloc(n))
 
+/*
+	An input source is read into memory whole and NUL terminated; a
+	nonzero mapLength means buffer is an mmap of the file.  savePtr and
+	saveLine are where to pick up again after an include returns.
+ */
 typedef struct fileListStruct {
-	FILE			*fyle;
 	struct fileListStruct	*next;
 	int			 saveLine;
 	char			*saveName;
+	char			*buffer;
+	char			*bufferEnd;
+	char			*savePtr;
+	size_t			 mapLength;
+	boolean			 binary;
 } fileList;
 
-EXTERN fileList	*inputStack;
-EXTERN fileList	*bottomOfInputStack;
-EXTERN FILE		*currentInput;
-EXTERN int		 currentLineNumber;
-EXTERN char		*currentFileName;
-EXTERN int		 globalIdCounter;
-EXTERN int		 globalIdAdjustment;
-EXTERN int		 objectBase;
-
-EXTERN FILE		*griFile;
-EXTERN FILE		*rawFile;
-EXTERN FILE		*cvFile;
-EXTERN FILE		*indirFile;
-EXTERN int		 indirectPass;
-EXTERN stringList	*cvInput;
-EXTERN char		*classFileName;
-EXTERN boolean		 debug;
-EXTERN boolean		 testMode;
-EXTERN boolean		 assignRelativeIds;
-EXTERN int		 useStartCount;
-EXTERN boolean		 insideDefinition;
-EXTERN boolean		 announceIncludes;
+/*
+	A binary raw file is a header -- BINARY_RAW_MAGIC and a four byte
+	hash of the class table -- then one record per object: the class
+	byte, a two byte length and the state vector.  The magic starts with
+	a newline so that the text lexer walks into one like a blank line.
+ */
+#define BINARY_RAW_MAGIC	"\ngrb"
+#define BINARY_RAW_HEADER	8
 
 #define MAXCLASS 256
-EXTERN classDescriptor	*classDefs[MAXCLASS+1];
-
 #define MAXNOID 256
-EXTERN int		 objectCount;
-EXTERN int		 rawCount;
-EXTERN object	        *noidArray[MAXNOID];
-EXTERN object		*altNoidArray[MAXNOID];
-EXTERN boolean		 noidAlive[MAXNOID];
-EXTERN boolean		 fredModeLexing;
-EXTERN char		*fredLexString;
 
+/* fred's own screen state; everything else is in the griddleContext */
 EXTERN boolean		 promptDefault;
+EXTERN boolean		 scriptMode;
 EXTERN char		 pathname[80];
 EXTERN char		 regionName[80];
-extern byte		 cv[512];
-extern int		 cvLength;
 EXTERN int		 displayNoid;
-EXTERN object		*undeleteBuffer;
 EXTERN int		 previousClass;
+EXTERN boolean		 noidChanged[MAXNOID];
+EXTERN boolean		 renoHasRegion;
+EXTERN byte		 renoNoids[2*MAXNOID];
+EXTERN int		 renoNoidsLength;
+
+/* a region as read, kept for going back to it (see fred2.c) */
+typedef struct cachedRegionStruct {
+	char				*fileName;
+	time_t				 fileTime;
+	off_t				 fileSize;
+	long				 lastUsed;
+	int				 objectCount;
+	int				 globalIdCounter;
+	object				*objects[MAXNOID];
+	byte				 cv[512];
+	int				 cvLength;
+	struct cachedRegionStruct	*next;
+} cachedRegion;
 
 /* C64 locations */
 #define KEYBOARD_OVERRIDE (word)0x0010
@@ -259,6 +286,7 @@ EXTERN int		 previousClass;
 #define CMD_CREATE  1
 #define CMD_SAVE_CV 2
 #define CMD_LOAD_CV 3
+#define CMD_PATCH_CV 4
 
 #define TRAP_EDIT_KEY   141
 #define UPPER_LEFT_KEY   18
@@ -278,13 +306,13 @@ EXTERN int		 previousClass;
 #define nextlc(line,col,dy) {++(line);if((line)>LINES-1){\
 	(line)=1;(col)+=(dy);}}
 
-#define myCont() if (!testMode) Cont();
+#define myCont() if (!gx->testMode) Cont();
 
-#define fredModeLexingOn() fredModeLexing = TRUE;
-#define fredModeLexingOff() { strcpy(fredLexString, "\n"); \
-	yylex(); fredModeLexing = FALSE; }
+#define fredModeLexingOn() gx->fredModeLexing = TRUE;
+#define fredModeLexingOff() { strcpy(gx->fredLexString, "\n"); \
+	lexToken(); gx->fredModeLexing = FALSE; }
 
-#define isAvatar(n) (noidArray[(n)]->class == 0)
+#define isAvatar(n) (gx->noidArray[(n)]->class == 0)
 
 typedef struct {
 	int		 west;
@@ -295,25 +323,256 @@ typedef struct {
 	int		*multi;
 	int		 multiCount;
 	int		 region;
+	int		 idBase;
+	int		 idCount;
+	int		*ids;
+	unsigned long	 identHash;
+	unsigned long	 templateHash;
+	unsigned long	 includeHash;
 } indirectEntry;
 
-EXTERN indirectEntry	*indirTable;
-EXTERN int		 indirCount;
-EXTERN char		 indirName[80];
-EXTERN int		 indirArgc;
-EXTERN char		*indirArgv[50];
-EXTERN int		 indirRegion;
-EXTERN boolean		 sortObjects;
+typedef enum {
+	PARAM_NONE, PARAM_LEFT, PARAM_CENTER, PARAM_RIGHT
+} paramFormat;
+
+typedef struct {
+	char		*text;
+	int		 length;
+	int		 param;
+	paramFormat	 format;
+	int		 width;
+} templatePiece;
+
+typedef struct templateStruct {
+	char			*name;
+	char			*text;
+	unsigned long		 hash;
+	templatePiece		*pieces;
+	int			 pieceCount;
+	struct templateStruct	*next;
+} template;
+
+#define LEDGER_HASH	1024
+
+/*
+	All of the state of a compilation -- symbol table, class definitions,
+	input stack, lexer buffers, the objects of the region being built and
+	so on -- hangs off a griddleContext, so that any number of them can be
+	compiled in one process.  gx is the context the current thread is
+	working in; see context.c.
+ */
+typedef struct {
+	boolean			 fredMode;
+	symbol			*symbolTable[HASH_MAX];
+	classDescriptor		*classDefs[MAXCLASS+1];
+	int			 errorCount;
+	boolean			 quiet;
+	jmp_buf			*fatalJump;
+	struct arenaBlockStruct	*arena;
+	struct exprBlockStruct	*exprBlocks;
+	expression		*freeExprs;
+
+	fileList		*inputStack;
+	fileList		*bottomOfInputStack;
+	int			 currentLineNumber;
+	char			*currentFileName;
+
+	union YYSTYPE		*yylval;	/* where the lexer puts values */
+	char			 yytext[256];
+	boolean			 newline;
+	boolean			 oldnewline;
+	char			*inptr;
+	char			 escapeBuffer[5];
+	boolean			 fredModeLexing;
+	char			*fredLexString;
+
+	int			 globalIdCounter;
+	int			 globalIdAdjustment;
+	int			 objectBase;
+	FILE			*griFile;
+	FILE			*rawFile;
+	boolean			 binaryRaw;
+	boolean			 rawHeaderWritten;
+	byte			*rawRecord;
+	int			 rawRecordSize;
+	FILE			*cvFile;
+	FILE			*indirFile;
+	int			 indirectPass;
+	stringList		*cvInput;
+	char			*classFileName;
+	boolean			 debug;
+	boolean			 testMode;
+	struct profileStruct	*profile;
+	boolean			 assignRelativeIds;
+	int			 useStartCount;
+	boolean			 insideDefinition;
+	boolean			 announceIncludes;
+
+	int			 objectCount;
+	int			 rawCount;
+	struct scratchIdStruct	*scratchIds;
+	int			 scratchIdSize;
+	int			 scratchIdCount;
+	object			*noidArray[MAXNOID];
+	object			*altNoidArray[MAXNOID];
+	boolean			 noidAlive[MAXNOID];
+	boolean			 sortObjects;
+
+	int			 classSize[MAXCLASS];
+	byte			 cv[512];
+	int			 cvLength;
+	FILE			*cvFyle;
+	object			*inNoid[MAXNOID];
+
+	indirectEntry		*indirTable;
+	int			 indirCount;
+	char			 indirName[80];
+	int			 indirArgc;
+	char			*indirArgv[50];
+	int			 indirRegion;
+	template		*templateList;
+
+	char			*manifestName;
+	struct manifestEntryStruct *oldManifest;
+	FILE			*newManifest;
+	char			*newManifestName;
+	FILE			*saveGriFile;
+	FILE			*saveRawFile;
+	char			*griBuffer;
+	char			*rawBuffer;
+	size_t			 griSize;
+	size_t			 rawSize;
+	boolean			 regionSetsSymbols;
+	boolean			 noReuse;
+
+	char			*archiveName;
+	struct archiveEntryStruct *archiveEntries;
+	int			 archiveCount;
+	FILE			*archiveData;
+	char			*archiveDataBuffer;
+	size_t			 archiveDataSize;
+	byte			*archiveMap;
+	size_t			 archiveMapLength;
+	char			*archiveMapName;
+	time_t			 archiveMapTime;
+
+	char			*ledgerName;
+	struct ledgerEntryStruct *ledgerTable[LEDGER_HASH];
+	int			 ledgerNext;
+	int			 ledgerSize;
+	char			*currentRegionKey;
+	int			*regionIds;
+	int			 regionIdCount;
+	int			 regionUseCount;
+	boolean			 mapRelativeIds;
+} griddleContext;
+
+extern __thread griddleContext	*gx;
+
+/*
+	Mark a stretch of code as a profiling phase (see prof.c):
+		phase = PROFILE_ENTER(PHASE_FILL); ... PROFILE_LEAVE(phase);
+ */
+#define PROFILE_ENTER(p)	(gx->profile != NULL ? enterPhase(p) : PHASE_OTHER)
+#define PROFILE_LEAVE(p)	if (gx->profile != NULL) leavePhase(p)
+
+
+#define HASH_START 2166136261UL
 
 void executeRawline(object	*obj);
+boolean lookupScratchId(int container, int id, int *relativeptr);
+int contNum(valueType vtype);
+void clearScratchIds(void);
+void outputRawObject(object *obj);
+int formatRawObject(object *obj, boolean binary);
+object *decodeBinaryRecord(byte **pp, byte *end, byte *start);
+void beginRawOutput(void);
+void binaryRawHeader(byte *header);
 void executeAssignment(symbol	*name, expression	*expr);
 void executeInclude(char	*filename);
+fileList *newInputSource(char *name);
+boolean loadInputSource(fileList *source);
+void releaseInputSource(fileList *source);
 void executeDefine(expression	*classExpr, char		*name, fieldList	*fields);
 fieldList *buildFieldList(fieldList	*list, field		*new);
 field *invisifyField(field	*aField);
 field *buildField(symbol	*name, expression	*dimension, fieldType	 type, exprList	*initList);
-expression *buildExpr(exprType	type, intptr_t	arg1, intptr_t	arg2, intptr_t	arg3);
-expression *buildExprI(exprType	type, intptr_t arg1);
-expression *buildExprP(exprType	type, void	*arg1);
-expression *buildExprIP(exprType	type, intptr_t arg1, void	*arg2);
-expression *buildExprPIP(exprType	type, void	*arg1, intptr_t arg2, void *arg3);
+expression *newExpr(exprType type);
+void freeExprPool(griddleContext *context);
+expression *buildNameExpr(symbol *name);
+expression *buildNumberExpr(int number);
+expression *buildStringExpr(char *string);
+expression *buildBitStringExpr(byte *bitString);
+expression *buildOperExpr(exprType type, int oper, expression *operand, expression *right);
+void prescanFile(char	*filename, boolean	 topLevel);
+char *openTemplate(char	*filename, int	*lengthptr);
+unsigned long hashBytes(unsigned long hash, byte *buf, int len);
+unsigned long hashString(unsigned long hash, char *s);
+unsigned long hashInt(unsigned long hash, int n);
+void openManifest(void);
+boolean reuseRegion(int reg);
+void beginRegionCapture(void);
+void endRegionCapture(int reg, int oldErrorCount);
+void closeManifest(void);
+void openArchive(void);
+void beginArchiveRegion(int reg);
+void archiveObject(object *obj);
+void endArchiveRegion(void);
+void closeArchive(void);
+boolean findArchiveRegion(char *name, char *key, byte **dataptr, int *lengthptr);
+void loadArchiveRegion(byte *data, int length);
+void readLedger(void);
+void beginLedgerRegion(int reg);
+int ledgerAssignId(char *tagName);
+void writeLedger(void);
+griddleContext *newGriddleContext(boolean fredMode);
+void freeGriddleContext(griddleContext *context);
+griddleContext *useGriddleContext(griddleContext *context);
+void resetRegionCounters(void);
+void discardInput(void);
+void fatalExit(void);
+int lexToken(void);
+void openProfile(char *fileName);
+profilePhase enterPhase(profilePhase phase);
+void leavePhase(profilePhase previous);
+int profileLex(void);
+void profileRegion(int reg);
+void closeProfile(void);
+void serveRequests(char *socketName);
+void startLink(void);
+void linkDown(byte *buf, word length, word addr);
+void linkUp(byte *buf, word length, word addr);
+void linkCont(void);
+void linkPause(int seconds);
+void linkWait(void);
+void linkTimes(double *waitptr, double *emulatorptr);
+boolean linkStatus(int *pendingptr, int *busyptr, int *doneptr);
+void prefetchRegions(char **names, int count);
+cachedRegion *takePrefetchedRegion(void);
+void resetJournal(void);
+void journalCommand(char key);
+long journalVersion(void);
+void startAutosave(char *fileName);
+char *newerAutosave(void);
+void autosave(boolean now);
+void forgetAutosave(void);
+void finishAutosave(void);
+value buildValue(valueType vtype, intptr_t val);
+value buildNumber(int val);
+value buildString(char *val);
+value buildBitString(byte *val);
+value evaluate(expression *expr);
+value integerize(value val);
+boolean isInteger(value val);
+boolean isString(value val);
+void freeExpr(expression *expr);
+void freeExprList(exprList *list);
+expression *foldExpr(expression *expr);
+void *arenaAlloc(int size);
+value keepValue(value val);
+symbol *lookupSymbol(char *name);
+char *saveString(char *s);
+exprList *buildExprList(exprList *list, expression *new);
+property *buildProperty(symbol *fieldName, exprList *data);
+propertyList *buildPropertyList(propertyList *list, property *new);
+objectTail *buildObjectTail(expression *idExpr, propertyList *propList);
@@ -60,11 +60,12 @@ scanIndirectFilePass1()
 	char	*skipArg();
 	boolean  stringFlag;
 	int	 rot;
+	int	 i;
 
-	indirRegion = 0;
-	indirectPass = 1;
-	while (fgets(line, MAXLINE, indirFile) != NULL) {
-		iptr = indirName;
+	gx->indirRegion = 0;
+	gx->indirectPass = 1;
+	while (fgets(line, MAXLINE, gx->indirFile) != NULL) {
+		iptr = gx->indirName;
 		argptr = line;
 		while (*argptr != ' ')
 			*iptr++ = *argptr++;
@@ -72,62 +73,71 @@ scanIndirectFilePass1()
 
 		argptr += 3;
 		argptr = scan_number(argptr, &rot);
-		indirTable[indirRegion].rot = rot;
+		gx->indirTable[gx->indirRegion].rot = rot;
 		argptr = scan_connections(argptr + 3, rot == 0,
-			&indirTable[indirRegion].west,
-			&indirTable[indirRegion].multi,
-			&indirTable[indirRegion].multiCount);
+			&gx->indirTable[gx->indirRegion].west,
+			&gx->indirTable[gx->indirRegion].multi,
+			&gx->indirTable[gx->indirRegion].multiCount);
 		argptr = scan_connections(argptr + 3, rot == 1,
-			&indirTable[indirRegion].north,
-			&indirTable[indirRegion].multi,
-			&indirTable[indirRegion].multiCount);
+			&gx->indirTable[gx->indirRegion].north,
+			&gx->indirTable[gx->indirRegion].multi,
+			&gx->indirTable[gx->indirRegion].multiCount);
 		argptr = scan_connections(argptr + 3, rot == 2,
-			&indirTable[indirRegion].east,
-			&indirTable[indirRegion].multi,
-			&indirTable[indirRegion].multiCount);
+			&gx->indirTable[gx->indirRegion].east,
+			&gx->indirTable[gx->indirRegion].multi,
+			&gx->indirTable[gx->indirRegion].multiCount);
 		argptr = scan_connections(argptr + 3, rot == 3,
-			&indirTable[indirRegion].south,
-			&indirTable[indirRegion].multi,
-			&indirTable[indirRegion].multiCount);
+			&gx->indirTable[gx->indirRegion].south,
+			&gx->indirTable[gx->indirRegion].multi,
+			&gx->indirTable[gx->indirRegion].multiCount);
 		argptr = index(argptr, '/') + 1;
-		indirArgc = 0;
+		gx->indirArgc = 0;
 		while (argptr != NULL && *argptr != '\0' && *argptr != '\n') {
 			while (*argptr == ' ')
 				++argptr;
 			if (stringFlag = (*argptr == '"'))
 				++argptr;
-			indirArgv[indirArgc++] = argptr;
+			gx->indirArgv[gx->indirArgc++] = argptr;
 			argptr = skipArg(argptr, stringFlag);
 			if (argptr != NULL)
 				*argptr++ = '\0';
 		}
-		queueInputFile(strcat(indirName, ".gri"));
-		if (!openFirstFile(FALSE)) {
-			error("can't continue from here!");
-			exit(1);
-		}
-		globalIdAdjustment = globalIdCounter - 1001;
-		yyparse();
-		++indirRegion;
+		gx->indirTable[gx->indirRegion].identHash =
+			hashString(HASH_START, gx->indirName);
+		for (i=0; i<gx->indirArgc; ++i)
+			gx->indirTable[gx->indirRegion].identHash = hashString(
+				gx->indirTable[gx->indirRegion].identHash,
+					gx->indirArgv[i]);
+		gx->indirTable[gx->indirRegion].includeHash = HASH_START;
+		gx->indirTable[gx->indirRegion].idBase = gx->globalIdCounter;
+		gx->indirTable[gx->indirRegion].ids = NULL;
+		if (gx->ledgerName != NULL)
+			beginLedgerRegion(gx->indirRegion);
+		prescanFile(strcat(gx->indirName, ".gri"), TRUE);
+		gx->indirTable[gx->indirRegion].idCount = gx->globalIdCounter -
+			gx->indirTable[gx->indirRegion].idBase;
+		++gx->indirRegion;
 	}
 }
 
   void
 scanIndirectFilePass2()
 {
-	char	 line[MAXLINE];
-	char	*argptr;
-	char	*iptr;
-	char	*index();
-	char	*skipArg();
-	boolean  stringFlag;
-	int	 dummy;
+	char		 line[MAXLINE];
+	char		*argptr;
+	char		*iptr;
+	char		*index();
+	char		*skipArg();
+	boolean		 stringFlag;
+	int		 dummy;
+	int		 oldErrorCount;
+	profilePhase	 phase;
 
-	indirRegion = 0;
-	indirectPass = 2;
-	globalIdCounter = 1001;
-	while (fgets(line, MAXLINE, indirFile) != NULL) {
-		iptr = indirName;
+	gx->indirRegion = 0;
+	gx->indirectPass = 2;
+	gx->globalIdCounter = 1001;
+	while (fgets(line, MAXLINE, gx->indirFile) != NULL) {
+		iptr = gx->indirName;
 		argptr = line;
 		while (*argptr != ' ')
 			*iptr++ = *argptr++;
@@ -140,27 +150,53 @@ scanIndirectFilePass2()
 		argptr = scan_connections(argptr, FALSE, &dummy, NULL,&dummy);
 		argptr = scan_connections(argptr, FALSE, &dummy, NULL,&dummy);
 		argptr = index(argptr, '/') + 1;
-		indirArgc = 0;
+		gx->indirArgc = 0;
 		while (argptr != NULL && *argptr != '\0' && *argptr != '\n') {
 			while (*argptr == ' ')
 				++argptr;
 			if (stringFlag = (*argptr == '"'))
 				++argptr;
-			indirArgv[indirArgc++] = argptr;
+			gx->indirArgv[gx->indirArgc++] = argptr;
 			argptr = skipArg(argptr, stringFlag);
 			if (argptr != NULL)
 				*argptr++ = '\0';
 				
 		}
-		queueInputFile(strcat(indirName, ".gri"));
+		strcat(gx->indirName, ".gri");
+		if (gx->manifestName != NULL && gx->archiveName == NULL &&
+				reuseRegion(gx->indirRegion)) {
+			gx->globalIdCounter +=
+				gx->indirTable[gx->indirRegion].idCount;
+			++gx->indirRegion;
+			continue;
+		}
+		oldErrorCount = gx->errorCount;
+		if (gx->manifestName != NULL)
+			beginRegionCapture();
+		if (gx->archiveName != NULL)
+			beginArchiveRegion(gx->indirRegion);
+		queueTemplateFile(gx->indirName);
 		if (!openFirstFile(FALSE)) {
 			error("can't continue from here!");
 			exit(1);
 		}
-		globalIdAdjustment = globalIdCounter - 1001;
+		gx->globalIdAdjustment = gx->globalIdCounter - 1001;
+		gx->regionIds = gx->indirTable[gx->indirRegion].ids;
+		gx->regionIdCount = gx->indirTable[gx->indirRegion].idCount;
+		gx->regionUseCount = 0;
+		gx->mapRelativeIds = (gx->regionIds != NULL);
+		profileRegion(gx->indirRegion);
+		phase = PROFILE_ENTER(PHASE_PARSE);
 		yyparse();
-		++indirRegion;
+		PROFILE_LEAVE(phase);
+		++gx->indirRegion;
+		flushNoidArray();
+		if (gx->archiveName != NULL)
+			endArchiveRegion();
+		if (gx->manifestName != NULL)
+			endRegionCapture(gx->indirRegion - 1, oldErrorCount);
 	}
+	profileRegion(-1);
 }
 
   void
@@ -172,25 +208,25 @@ replaceIndirectArgs(obj, index)
 	byte	*buf;
 	int	 reg;
 
-	reg = indirRegion - 1;
+	reg = gx->indirRegion - 1;
 	buf = obj->stateVector;
 	if (obj->class == CLASS_REGION) {
 		fillLong(buf, WEST_OFFSET_REG,
-			getIdent(indirTable[reg].west));
+			getIdent(gx->indirTable[reg].west));
 		fillLong(buf, NORTH_OFFSET_REG,
-			getIdent(indirTable[reg].north));
+			getIdent(gx->indirTable[reg].north));
 		fillLong(buf, EAST_OFFSET_REG,
-			 getIdent(indirTable[reg].east));
+			 getIdent(gx->indirTable[reg].east));
 		fillLong(buf, SOUTH_OFFSET_REG,
-			getIdent(indirTable[reg].south));
-		fillWord(buf, ORIENT_OFFSET_REG, indirTable[reg].rot);
+			getIdent(gx->indirTable[reg].south));
+		fillWord(buf, ORIENT_OFFSET_REG, gx->indirTable[reg].rot);
 	} else if (obj->class == CLASS_DOOR || obj->class == CLASS_BUILDING) {
-	    if (index <= indirTable[reg].multiCount) {
+	    if (index <= gx->indirTable[reg].multiCount) {
 		fillLong(buf, CONNECTION_OFFSET_DOOR,
-			getIdent(indirTable[reg].multi[index-1]));
-		if (index == indirTable[reg].multiCount) {
-			buf = altNoidArray[0]->stateVector;
-			switch (indirTable[reg].rot) {
+			getIdent(gx->indirTable[reg].multi[index-1]));
+		if (index == gx->indirTable[reg].multiCount) {
+			buf = gx->altNoidArray[0]->stateVector;
+			switch (gx->indirTable[reg].rot) {
 				Case 0: fillLong(buf, WEST_OFFSET_REG, -1);
 				Case 1: fillLong(buf, NORTH_OFFSET_REG, -1);
 				Case 2: fillLong(buf, EAST_OFFSET_REG, -1);
@@ -209,7 +245,7 @@ getIdent(num)
 	if (num == 0)
 		return(-1);
 	else
-		return(indirTable[num - 1].region);
+		return(gx->indirTable[num - 1].region);
 }
 
   char *
@@ -228,86 +264,204 @@ skipArg(line, stringFlag)
 	return(line);
 }
 
-  void
-replaceParams(line)
-  char	*line;
+  char *
+formatParam(outptr, arg, format, width)
+  char		*outptr;
+  char		*arg;
+  paramFormat	 format;
+  int		 width;
 {
-	char	 scratchBuf[500];
-	char	*outptr;
-	char	*argptr;
-	char	*inptr;
-	int	 offset;
-	enum { LEFT, CENTER, RIGHT, NONE } format;
-	int	 width;
 	int	 i;
 	int	 len;
 
-	outptr = scratchBuf;
-	inptr = line;
+	len = strlen(arg);
+	switch (format) {
+	Case PARAM_NONE:
+		memcpy(outptr, arg, len);
+		outptr += len;
+	Case PARAM_LEFT:
+		for (i=0; *arg != '\0' && i < width; ++i)
+			*outptr++ = *arg++;
+		for (; i < width; ++i)
+			*outptr++ = ' ';
+
+	Case PARAM_RIGHT:
+		if (len < width)
+			for (i=width-len; i > 0; --i)
+				*outptr++ = ' ';
+		else
+			arg += len - width;
+		while (*arg != '\0')
+			*outptr++ = *arg++;
+
+	Case PARAM_CENTER:
+		i = 0;
+		if (len < width)
+			for (; i < (width-len)/2; ++i)
+				*outptr++ = ' ';
+		else
+			arg += (len - width) / 2;
+		for (; i<width && *arg!='\0'; ++i)
+			*outptr++ = *arg++;
+		for (; i<width; ++i)
+			*outptr++ = ' ';
+	}
+	return(outptr);
+}
+
+  void
+addTemplatePiece(tmpl, text, length, param, format, width)
+  template	*tmpl;
+  char		*text;
+  int		 length;
+  int		 param;
+  paramFormat	 format;
+  int		 width;
+{
+	templatePiece	*piece;
+
+	if (text != NULL && length == 0)
+		return;
+	if ((tmpl->pieceCount & 15) == 0)
+		tmpl->pieces = (templatePiece *)realloc(tmpl->pieces,
+			(tmpl->pieceCount + 16) * sizeof(templatePiece));
+	piece = &tmpl->pieces[tmpl->pieceCount++];
+	piece->text = text;
+	piece->length = length;
+	piece->param = param;
+	piece->format = format;
+	piece->width = width;
+}
+
+/*
+	Region files named by an indirect file are templates with backtick
+	parameters in them.  Each one is read and split into literal text and
+	parameter slots the first time it is named; after that instantiating
+	it for another indirect line is just a matter of splicing in that
+	line's arguments.
+ */
+  template *
+loadTemplate(filename)
+  char	*filename;
+{
+	template	*tmpl;
+	FILE		*fyle;
+	char		*source;
+	char		*inptr;
+	char		*outptr;
+	char		*literal;
+	long		 size;
+	int		 offset;
+	int		 width;
+	paramFormat	 format;
+	char		*saveString();
+
+	for (tmpl = gx->templateList; tmpl != NULL; tmpl = tmpl->next)
+		if (strcmp(tmpl->name, filename) == 0)
+			return(tmpl);
+	if ((fyle = fopen(filename, "r")) == NULL)
+		return(NULL);
+	fseek(fyle, 0L, 2);
+	size = ftell(fyle);
+	rewind(fyle);
+	source = malloc(size + 1);
+	size = fread(source, 1, size, fyle);
+	source[size] = '\0';
+	fclose(fyle);
+
+	tmpl = typeAlloc(template);
+	tmpl->name = saveString(filename);
+	tmpl->hash = hashBytes(HASH_START, (byte *)source, size);
+	tmpl->pieces = NULL;
+	tmpl->pieceCount = 0;
+	tmpl->text = malloc(size + 1);
+	literal = outptr = tmpl->text;
+	inptr = source;
 	while (*inptr != '\0') {
 		if (*inptr == '`') {
+			addTemplatePiece(tmpl, literal, outptr - literal, 0,
+				PARAM_NONE, 0);
 			offset = scanNumber(&inptr);
+			width = 0;
 			if (*inptr == 'l' || *inptr == 'r' || *inptr == 'c') {
-				format = (*inptr == 'l') ? LEFT :
-					((*inptr == 'r') ? RIGHT : CENTER);
+				format = (*inptr == 'l') ? PARAM_LEFT :
+					((*inptr == 'r') ? PARAM_RIGHT :
+					PARAM_CENTER);
 				width = scanNumber(&inptr) + 1;
 			} else
-				format = NONE;
-			if (indirArgc < offset)
-				error("parameter offset %d out of range\n",
-					offset);
-			else if (offset == -1)
-				*outptr++ = '`';
-			else {
-				len = strlen(indirArgv[offset]);
-				switch (format) {
-				Case NONE:
-					for (argptr=indirArgv[offset];
-							*argptr != '\0'; )
-						*outptr++ = *argptr++;
-				Case LEFT:
-					for (argptr=indirArgv[offset], i=0;
-							*argptr != '\0' &&
-							i < width; ++i)
-						*outptr++ = *argptr++;
-					for (; i < width; ++i)
-						*outptr++ = ' ';
-
-				Case RIGHT:
-					argptr = indirArgv[offset];
-					if (len < width)
-						for (i=width-len; i > 0; --i)
-							*outptr++ = ' ';
-					else
-						argptr += len - width;
-					while (*argptr != '\0')
-						*outptr++ = *argptr++;
-
-				Case CENTER:
-					argptr = indirArgv[offset];
-					i = 0;
-					if (len < width)
-						for (; i < (width-len)/2; ++i)
-							*outptr++ = ' ';
-					else
-						argptr += (len - width) / 2;
-					for (; i<width && *argptr!='\0'; ++i)
-						*outptr++ = *argptr++;
-					for (; i<width; ++i)
-						*outptr++ = ' ';
-				}
-			}
+				format = PARAM_NONE;
+			addTemplatePiece(tmpl, NULL, 0, offset, format, width);
+			literal = outptr;
 		} else {
 			if (*inptr == '\\') {
-				++inptr;
+				if (*++inptr == '\0')
+					break;
 				if (*inptr != '`')
 					*outptr++ = '\\';
 			}
 			*outptr++ = *inptr++;
 		}
 	}
+	addTemplatePiece(tmpl, literal, outptr - literal, 0, PARAM_NONE, 0);
+	free(source);
+	tmpl->next = gx->templateList;
+	gx->templateList = tmpl;
+	return(tmpl);
+}
+
+  char *
+instantiateTemplate(tmpl, lengthptr)
+  template	*tmpl;
+  int		*lengthptr;
+{
+	templatePiece	*piece;
+	char		*result;
+	char		*outptr;
+	int		 size;
+	int		 len;
+	int		 i;
+
+	size = 1;
+	for (i=0, piece=tmpl->pieces; i<tmpl->pieceCount; ++i, ++piece) {
+		if (piece->text != NULL)
+			size += piece->length;
+		else if (0 <= piece->param && piece->param < gx->indirArgc) {
+			len = strlen(gx->indirArgv[piece->param]);
+			size += (len > piece->width) ? len : piece->width;
+		} else
+			size += 1;
+	}
+	result = outptr = malloc(size);
+	for (i=0, piece=tmpl->pieces; i<tmpl->pieceCount; ++i, ++piece) {
+		if (piece->text != NULL) {
+			memcpy(outptr, piece->text, piece->length);
+			outptr += piece->length;
+		} else if (gx->indirArgc <= piece->param)
+			error("parameter offset %d out of range\n",
+				piece->param);
+		else if (piece->param == -1)
+			*outptr++ = '`';
+		else
+			outptr = formatParam(outptr,
+				gx->indirArgv[piece->param],
+				piece->format, piece->width);
+	}
 	*outptr = '\0';
-	strcpy(line, scratchBuf);
+	if (lengthptr != NULL)
+		*lengthptr = outptr - result;
+	return(result);
+}
+
+  char *
+openTemplate(filename, lengthptr)
+  char	*filename;
+  int	*lengthptr;
+{
+	template	*tmpl;
+
+	if ((tmpl = loadTemplate(filename)) == NULL)
+		return(NULL);
+	return(instantiateTemplate(tmpl, lengthptr));
 }
 
   int
@@ -325,20 +479,232 @@ scanNumber(lineptr)
 	return(result - 1);
 }
 
+  char *
+skipPrescanComment(p)
+  char	*p;
+{
+	while (*p != '\0') {
+		if (*p == '*' && p[1] == '/')
+			return(p + 2);
+		++p;
+	}
+	return(p);
+}
+
+  char *
+skipPrescanString(p, buf)
+  char	*p;
+  char	*buf;
+{
+	char	 end;
+	char	*bufEnd;
+
+	end = *p++;
+	bufEnd = buf + 255;
+	while (*p != end && *p != '\0') {
+		if (*p == '\\' && p[1] != '\0') {
+			if (p[1] == '^' && p[2] != '\0')
+				++p;
+			++p;
+		}
+		if (buf < bufEnd)
+			*buf++ = *p;
+		++p;
+	}
+	*buf = '\0';
+	if (*p == end)
+		++p;
+	if (end == '\'' && (*p == 'b' || *p == 'B'))
+		++p;
+	return(p);
+}
+
+  char *
+skipPrescanRawline(p)
+  char	*p;
+{
+	while (*p != '\n' && *p != '\0') {
+		if (*p == '\\' && p[1] != '\0')
+			++p;
+		++p;
+	}
+	return(p);
+}
+
+  char *
+skipPrescanNumber(p)
+  char	*p;
+{
+	if (*p == '0' && (p[1] == 'x' || p[1] == 'X')) {
+		for (p += 2; isDigit(*p, 16); ++p)
+			;
+	} else {
+		while ('0' <= *p && *p <= '9')
+			++p;
+	}
+	return(p);
+}
+
+#define isIdentStart(c) \
+	(('a' <= (c) && (c) <= 'z') || ('A' <= (c) && (c) <= 'Z') || (c) == '_')
+
+  void
+prescanUse(className, tagName)
+  char	*className;
+  char	*tagName;
+{
+	symbol	*class;
+	symbol	*lookupSymbol();
+	int	 id;
+
+	class = lookupSymbol(className);
+	if (class->type != CLASS_SYM)
+		return;
+	if (gx->ledgerName != NULL)
+		id = ledgerAssignId(tagName);
+	else
+		id = gx->globalIdCounter;
+	if (class->def.class == CLASS_REGION)
+		gx->indirTable[gx->indirRegion].region = -id;
+	++gx->globalIdCounter;
+}
+
+/*
+	Pass 1 of an indirect build only has to learn the global ID of each
+	region, so instead of parsing and evaluating the region files we
+	just scan them for use statements, counting off global IDs exactly
+	the way generateObject() will in pass 2.  Comments, strings and raw
+	lines are skipped so that nothing inside them is mistaken for a use.
+ */
+  void
+prescanText(text)
+  char	*text;
+{
+	char	*p;
+	char	*namePtr;
+	char	 name[256];
+	char	 className[256];
+	boolean	 atLineStart;
+	enum { NOTHING, SAW_USE, SAW_CLASS, SAW_INCLUDE } pending;
+
+	p = text;
+	atLineStart = TRUE;
+	pending = NOTHING;
+	while (*p != '\0') {
+		if (atLineStart && *p == '/') {
+			p = skipPrescanRawline(p);
+			atLineStart = FALSE;
+			continue;
+		}
+		atLineStart = FALSE;
+		if (*p == '\n') {
+			atLineStart = TRUE;
+			++p;
+		} else if (*p == '/' && p[1] == '*') {
+			p = skipPrescanComment(p + 2);
+		} else if (pending == SAW_CLASS && *p != ' ' && *p != '\t' &&
+				!isIdentStart(*p)) {
+			prescanUse(className, NULL);
+			pending = NOTHING;
+		} else if (*p == '"' || *p == '\'') {
+			p = skipPrescanString(p, name);
+			if (pending == SAW_INCLUDE)
+				prescanFile(name, FALSE);
+			pending = NOTHING;
+		} else if ('0' <= *p && *p <= '9') {
+			p = skipPrescanNumber(p);
+		} else if (isIdentStart(*p)) {
+			namePtr = name;
+			while ((('a' <= *p && *p <= 'z') || ('A' <= *p &&
+					*p <= 'Z') || ('0' <= *p && *p <= '9') ||
+					*p == '_') && namePtr < name + 255)
+				*namePtr++ = *p++;
+			*namePtr = '\0';
+			if (pending == SAW_USE) {
+				strcpy(className, name);
+				pending = SAW_CLASS;
+			} else if (pending == SAW_CLASS) {
+				prescanUse(className, name);
+				pending = NOTHING;
+			} else if (strcmp(name, "use") == 0)
+				pending = SAW_USE;
+			else if (strcmp(name, "include") == 0)
+				pending = SAW_INCLUDE;
+			else
+				pending = NOTHING;
+		} else
+			++p;
+	}
+	if (pending == SAW_CLASS)
+		prescanUse(className, NULL);
+}
+
+  void
+prescanFile(filename, topLevel)
+  char		*filename;
+  boolean	 topLevel;
+{
+	char		*text;
+	template	*tmpl;
+	indirectEntry	*entry;
+
+	if (gx->announceIncludes && !topLevel) {
+		fprintf(stderr, "->%s\n", filename);
+		fflush(stderr);
+	}
+	if ((tmpl = loadTemplate(filename)) == NULL) {
+		if (topLevel) {
+			error("can't open input file %s\n", filename);
+			error("can't continue from here!");
+		} else
+			error("unable to open include file '%s'\n", filename);
+		exit(1);
+	}
+	entry = &gx->indirTable[gx->indirRegion];
+	if (topLevel)
+		entry->templateHash = tmpl->hash;
+	else
+		entry->includeHash = hashString(hashInt(entry->includeHash,
+			tmpl->hash), filename);
+	text = instantiateTemplate(tmpl, NULL);
+	prescanText(text);
+	free(text);
+	if (gx->announceIncludes && !topLevel) {
+		fprintf(stderr, "<-\n");
+		fflush(stderr);
+	}
+}
+
   void
 indirectGriddle()
 {
 	char	line[80];
 	int	i;
 
-	fgets(line, 80, indirFile);
-	sscanf(line, "%d", &indirCount);
-	indirTable = typeAllocMulti(indirectEntry, indirCount);
+	if (!openFirstFile(FALSE))
+		exit(1);
+	yyparse();
+
+	fgets(line, 80, gx->indirFile);
+	sscanf(line, "%d", &gx->indirCount);
+	gx->indirTable = typeAllocMulti(indirectEntry, gx->indirCount);
+	if (gx->ledgerName != NULL)
+		readLedger();
 	scanIndirectFilePass1();
 
-	rewind(indirFile);
+	rewind(gx->indirFile);
 	flushNoidArray();
-	fgets(line, 80, indirFile);
+	if (gx->manifestName != NULL)
+		openManifest();
+	if (gx->archiveName != NULL)
+		openArchive();
+	fgets(line, 80, gx->indirFile);
 	scanIndirectFilePass2();
 	flushNoidArray();
+	if (gx->manifestName != NULL)
+		closeManifest();
+	if (gx->archiveName != NULL)
+		closeArchive();
+	if (gx->ledgerName != NULL)
+		writeLedger();
 }
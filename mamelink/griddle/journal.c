@@ -0,0 +1,252 @@
+/*
+	Undo and redo.
+
+	After every command fred compares the region with a shadow copy of
+	it as it was after the command before, and journals the objects that
+	changed, as they were before the command and after it.  Comparing
+	against the shadow costs a memcmp() per object, and only objects that
+	changed are copied.  Undo puts back the 'before' copies of the last
+	command's objects and redo the 'after' ones, and Reno is sent just
+	those objects (see uploadRegion()).
+
+	Loading a region starts the journal afresh; it holds at most
+	MAXJOURNAL commands.
+ */
+
+#include "griddleDefs.h"
+
+#define MAXJOURNAL	200
+
+typedef struct objectChangeStruct {
+	struct objectChangeStruct	*next;
+	int				 noid;
+	object				*before;
+	object				*after;
+} objectChange;
+
+typedef struct journalEntryStruct {
+	struct journalEntryStruct	*previous;
+	struct journalEntryStruct	*next;
+	char				 key;
+	int				 countBefore;
+	int				 countAfter;
+	objectChange			*changes;
+} journalEntry;
+
+static object		*shadow[MAXNOID];
+static int		 shadowCount = 0;
+static journalEntry	*firstEntry = NULL;
+static journalEntry	*lastDone = NULL;
+static int		 entryCount = 0;
+static long		 version = 0;
+
+object	*copyObject();
+void	 uploadRegion();
+void	 displayOneObject();
+char	*keyName();
+
+  static void
+freeJournalEntry(entry)
+  journalEntry	*entry;
+{
+	objectChange	*change;
+	objectChange	*next;
+
+	for (change = entry->changes; change != NULL; change = next) {
+		next = change->next;
+		if (change->before != NULL)
+			freeObject(change->before);
+		if (change->after != NULL)
+			freeObject(change->after);
+		free(change);
+	}
+	free(entry);
+}
+
+/*
+	Throw away the entries after 'entry', or all of them if it is NULL.
+ */
+  static void
+truncateJournal(entry)
+  journalEntry	*entry;
+{
+	journalEntry	*doomed;
+	journalEntry	*next;
+
+	doomed = entry == NULL ? firstEntry : entry->next;
+	for (; doomed != NULL; doomed = next) {
+		next = doomed->next;
+		freeJournalEntry(doomed);
+		--entryCount;
+	}
+	if (entry == NULL)
+		firstEntry = NULL;
+	else
+		entry->next = NULL;
+}
+
+  static void
+setShadow(noid, obj)
+  int	 noid;
+  object	*obj;
+{
+	if (shadow[noid] != NULL)
+		freeObject(shadow[noid]);
+	shadow[noid] = copyObject(obj);
+}
+
+/*
+	Start again from the region as it is now.
+ */
+  void
+resetJournal()
+{
+	int	noid;
+
+	truncateJournal((journalEntry *)NULL);
+	lastDone = NULL;
+	for (noid=0; noid<MAXNOID; ++noid)
+		setShadow(noid, noid < gx->objectCount ?
+			gx->noidArray[noid] : (object *)NULL);
+	shadowCount = gx->objectCount;
+}
+
+/*
+	A count of the changes journalled, undone and redone, for telling
+	whether the region has changed since some earlier time.
+ */
+  long
+journalVersion()
+{
+	return(version);
+}
+
+  static boolean
+sameObject(obj1, obj2)
+  object	*obj1;
+  object	*obj2;
+{
+	if (obj1 == NULL || obj2 == NULL)
+		return(obj1 == obj2);
+	return(obj1->class == obj2->class &&
+		memcmp(obj1->stateVector, obj2->stateVector,
+		gx->classDefs[obj1->class+1]->size) == 0);
+}
+
+/*
+	Journal whatever command 'key' changed.
+ */
+  void
+journalCommand(key)
+  char	key;
+{
+	journalEntry	*entry;
+	journalEntry	*oldest;
+	objectChange	*change;
+	object		*live;
+	int		 limit;
+	int		 noid;
+
+	limit = gx->objectCount > shadowCount ? gx->objectCount : shadowCount;
+	entry = NULL;
+	for (noid=limit-1; noid>=0; --noid) {
+		live = noid < gx->objectCount ? gx->noidArray[noid] : NULL;
+		if (sameObject(live, shadow[noid]))
+			continue;
+		if (entry == NULL) {
+			entry = typeAlloc(journalEntry);
+			entry->key = key;
+			entry->countBefore = shadowCount;
+			entry->countAfter = gx->objectCount;
+			entry->changes = NULL;
+		}
+		change = typeAlloc(objectChange);
+		change->noid = noid;
+		change->before = shadow[noid];
+		change->after = copyObject(live);
+		change->next = entry->changes;
+		entry->changes = change;
+		shadow[noid] = copyObject(live);
+	}
+	shadowCount = gx->objectCount;
+	if (entry == NULL)
+		return;
+	++version;
+
+	truncateJournal(lastDone);
+	entry->previous = lastDone;
+	entry->next = NULL;
+	if (lastDone == NULL)
+		firstEntry = entry;
+	else
+		lastDone->next = entry;
+	lastDone = entry;
+	if (++entryCount > MAXJOURNAL) {
+		oldest = firstEntry;
+		firstEntry = oldest->next;
+		firstEntry->previous = NULL;
+		freeJournalEntry(oldest);
+		--entryCount;
+	}
+}
+
+/*
+	Put the objects 'entry' changed back as they were before it, or as
+	they were after it, and bring Reno up to date.
+ */
+  static void
+replayJournalEntry(entry, backwards)
+  journalEntry	*entry;
+  boolean	 backwards;
+{
+	objectChange	*change;
+	object		*obj;
+
+	for (change = entry->changes; change != NULL; change = change->next) {
+		obj = backwards ? change->before : change->after;
+		if (change->noid < gx->objectCount &&
+				gx->noidArray[change->noid] != NULL)
+			freeObject(gx->noidArray[change->noid]);
+		gx->noidArray[change->noid] = copyObject(obj);
+		setShadow(change->noid, obj);
+		noidChanged[change->noid] = TRUE;
+	}
+	gx->objectCount = shadowCount =
+		backwards ? entry->countBefore : entry->countAfter;
+	++version;
+	uploadRegion();
+	displayNoid = entry->changes->noid;
+	if (displayNoid >= gx->objectCount ||
+			gx->noidArray[displayNoid] == NULL)
+		displayNoid = 0;
+	displayOneObject(displayNoid);
+}
+
+  boolean
+undo()
+{
+	if (lastDone == NULL)
+		lineError("nothing to undo");
+	else {
+		replayJournalEntry(lastDone, TRUE);
+		echoLine("undid '%s'", keyName(lastDone->key));
+		lastDone = lastDone->previous;
+	}
+	return(TRUE);
+}
+
+  boolean
+redo()
+{
+	journalEntry	*entry;
+
+	entry = lastDone == NULL ? firstEntry : lastDone->next;
+	if (entry == NULL)
+		lineError("nothing to redo");
+	else {
+		replayJournalEntry(entry, FALSE);
+		echoLine("redid '%s'", keyName(entry->key));
+		lastDone = entry;
+	}
+	return(TRUE);
+}
@@ -0,0 +1,228 @@
+/*
+	Stable global IDs for indirect builds.
+
+	Normally the objects in an indirect build are numbered in the order
+	they are encountered, so adding one object near the front of a world
+	renumbers everything after it.  When griddle is given -L, it instead
+	keeps a ledger mapping each object -- identified by the region it is
+	in (template name plus arguments) and either its tag or, for untagged
+	objects, its position within the region -- to the global ID it was
+	given last time.  Objects found in the ledger keep their IDs; new
+	objects are numbered from the ledger's high-water mark, so IDs are
+	never reused.
+ */
+
+#include "griddleDefs.h"
+
+#define LEDGER_MAGIC	"griddle ledger 1"
+#define MAXLEDGERLINE	1000
+
+typedef struct ledgerEntryStruct {
+	char				*regionKey;
+	char				*objectKey;
+	int				 id;
+	boolean				 used;
+	struct ledgerEntryStruct	*next;
+} ledgerEntry;
+
+  static int
+ledgerHash(regionKey, objectKey)
+  char	*regionKey;
+  char	*objectKey;
+{
+	return(hashString(hashString(HASH_START, regionKey), objectKey) &
+		(LEDGER_HASH - 1));
+}
+
+  static ledgerEntry *
+addLedgerEntry(regionKey, objectKey, id)
+  char	*regionKey;
+  char	*objectKey;
+  int	 id;
+{
+	ledgerEntry	*entry;
+	int		 hashval;
+	char		*saveString();
+
+	entry = typeAlloc(ledgerEntry);
+	entry->regionKey = saveString(regionKey);
+	entry->objectKey = saveString(objectKey);
+	entry->id = id;
+	entry->used = FALSE;
+	hashval = ledgerHash(regionKey, objectKey);
+	entry->next = gx->ledgerTable[hashval];
+	gx->ledgerTable[hashval] = entry;
+	++gx->ledgerSize;
+	if (id >= gx->ledgerNext)
+		gx->ledgerNext = id + 1;
+	return(entry);
+}
+
+  static ledgerEntry *
+findLedgerEntry(regionKey, objectKey)
+  char	*regionKey;
+  char	*objectKey;
+{
+	ledgerEntry	*entry;
+
+	for (entry = gx->ledgerTable[ledgerHash(regionKey, objectKey)];
+			entry != NULL; entry = entry->next)
+		if (strcmp(entry->objectKey, objectKey) == 0 &&
+				strcmp(entry->regionKey, regionKey) == 0)
+			return(entry);
+	return(NULL);
+}
+
+/*
+	Ledger lines are tab separated: the ID, the object key, and the
+	region key, which is itself an occurrence count followed by the
+	template name and its arguments.
+ */
+  void
+readLedger()
+{
+	FILE	*fyle;
+	char	 line[MAXLEDGERLINE];
+	char	*objectKey;
+	char	*regionKey;
+	char	*end;
+	int	 id;
+	int	 next;
+	char	*index();
+
+	gx->ledgerNext = 1001;
+	gx->ledgerSize = 0;
+	if ((fyle = fopen(gx->ledgerName, "r")) == NULL)
+		return;
+	if (fgets(line, MAXLEDGERLINE, fyle) == NULL ||
+			strncmp(line, LEDGER_MAGIC, strlen(LEDGER_MAGIC)) != 0) {
+		error("%s is not a griddle ledger\n", gx->ledgerName);
+		exit(1);
+	}
+	if (fscanf(fyle, "next %d\n", &next) == 1 && next > gx->ledgerNext)
+		gx->ledgerNext = next;
+	while (fgets(line, MAXLEDGERLINE, fyle) != NULL) {
+		if ((end = index(line, '\n')) != NULL)
+			*end = '\0';
+		id = atoi(line);
+		if ((objectKey = index(line, '\t')) == NULL ||
+		    (regionKey = index(++objectKey, '\t')) == NULL) {
+			error("bad line in ledger %s: %s\n", gx->ledgerName,
+				line);
+			continue;
+		}
+		*regionKey++ = '\0';
+		addLedgerEntry(regionKey, objectKey, id);
+	}
+	fclose(fyle);
+}
+
+/*
+	Called in pass 1 before a region is prescanned, while indirName and
+	indirArgv still describe its line of the indirect file.
+ */
+  void
+beginLedgerRegion(reg)
+  int	reg;
+{
+	int	 occurrence;
+	int	 length;
+	int	 i;
+
+	occurrence = 0;
+	for (i=0; i<reg; ++i)
+		if (gx->indirTable[i].identHash ==
+				gx->indirTable[reg].identHash)
+			++occurrence;
+	length = strlen(gx->indirName) + 20;
+	for (i=0; i<gx->indirArgc; ++i)
+		length += strlen(gx->indirArgv[i]) + 1;
+	if (gx->currentRegionKey != NULL)
+		free(gx->currentRegionKey);
+	gx->currentRegionKey = malloc(length);
+	sprintf(gx->currentRegionKey, "%d\t%s", occurrence, gx->indirName);
+	for (i=0; i<gx->indirArgc; ++i) {
+		strcat(gx->currentRegionKey, "\t");
+		strcat(gx->currentRegionKey, gx->indirArgv[i]);
+	}
+}
+
+/*
+	Give the next object in the current region its ledger ID, recording
+	it in the region's ID table for pass 2.
+ */
+  int
+ledgerAssignId(tagName)
+  char	*tagName;
+{
+	indirectEntry	*entry;
+	ledgerEntry	*ledger;
+	char		 ordinalKey[20];
+	int		 ordinal;
+
+	entry = &gx->indirTable[gx->indirRegion];
+	ordinal = gx->globalIdCounter - entry->idBase;
+	sprintf(ordinalKey, "#%d", ordinal);
+	if (tagName != NULL && ((ledger = findLedgerEntry(gx->currentRegionKey,
+			tagName)) == NULL || !ledger->used)) {
+		if (ledger == NULL)
+			ledger = addLedgerEntry(gx->currentRegionKey, tagName,
+				gx->ledgerNext);
+	} else if ((ledger = findLedgerEntry(gx->currentRegionKey, ordinalKey))
+			== NULL || ledger->used)
+		ledger = addLedgerEntry(gx->currentRegionKey, ordinalKey,
+			gx->ledgerNext);
+	ledger->used = TRUE;
+	if ((ordinal & 15) == 0)
+		entry->ids = (int *)realloc(entry->ids,
+			(ordinal + 16) * sizeof(int));
+	entry->ids[ordinal] = ledger->id;
+	return(ledger->id);
+}
+
+  static int
+compareLedgerEntries(e1, e2)
+  ledgerEntry	**e1;
+  ledgerEntry	**e2;
+{
+	return((*e1)->id - (*e2)->id);
+}
+
+/*
+	Write out the entries used by this build, in ID order, replacing the
+	old ledger only once the new one is safely on disk.
+ */
+  void
+writeLedger()
+{
+	FILE		 *fyle;
+	char		 *newName;
+	ledgerEntry	**sorted;
+	ledgerEntry	 *entry;
+	int		  count;
+	int		  i;
+
+	sorted = typeAllocMulti(ledgerEntry *, gx->ledgerSize + 1);
+	count = 0;
+	for (i=0; i<LEDGER_HASH; ++i)
+		for (entry = gx->ledgerTable[i]; entry != NULL;
+				entry = entry->next)
+			if (entry->used)
+				sorted[count++] = entry;
+	qsort(sorted, count, sizeof(ledgerEntry *), compareLedgerEntries);
+
+	newName = malloc(strlen(gx->ledgerName) + 5);
+	sprintf(newName, "%s.new", gx->ledgerName);
+	if ((fyle = fopen(newName, "w")) == NULL)
+		systemError("can't open ledger file %s\n", newName);
+	fprintf(fyle, "%s\nnext %d\n", LEDGER_MAGIC, gx->ledgerNext);
+	for (i=0; i<count; ++i)
+		fprintf(fyle, "%d\t%s\t%s\n", sorted[i]->id,
+			sorted[i]->objectKey, sorted[i]->regionKey);
+	if (fclose(fyle) != 0)
+		systemError("can't write ledger file %s\n", newName);
+	if (rename(newName, gx->ledgerName) != 0)
+		systemError("can't replace ledger file %s\n", gx->ledgerName);
+	free(newName);
+	free(sorted);
+}
@@ -1,9 +1,23 @@
 #include "griddleDefs.h"
 #include "y.tab.h"
 
-extern int yylval;
 extern int yydebug;
 
+/*
+	The current source is all in memory and NUL terminated, so reading a
+	character is just a pointer bump; only the NUL goes out of line.
+	unput() backs the pointer up over the character just read.
+ */
+#define input() (*gx->inptr == '\0' ? nextInput() : \
+	*gx->inptr == '\n' ? (++gx->currentLineNumber, *gx->inptr++) : \
+	*gx->inptr++)
+#define unput(c) ((c) != '\0' && *--gx->inptr == '\n' ? \
+	--gx->currentLineNumber : 0)
+
+char		nextInput();
+static int	scanToken();
+char		*escape();
+
 typedef enum {
 	C_SKIP, C_ZERO, C_DIG, C_ALPH, C_QUOTE, C_APOSTROPHE, C_LIT, C_SLASH,
 	C_NL
@@ -79,22 +93,139 @@ static int litCode[128] = {
 /*120 */ 0,      0,      0,      '{',    OR,     '}',    0,      0
 };
 
-static boolean newline = TRUE;
-static boolean oldnewline;
+  int
+yylex(lvalp)
+  YYSTYPE	*lvalp;
+{
+	gx->yylval = lvalp;
+	if (gx->profile != NULL)
+		return(profileLex());
+	return(lexToken());
+}
+
+/*
+	fred lexes values out of a string it owns, so point the scan at it
+	for the one token and leave it pointing past what was read.
+ */
+  int
+lexToken()
+{
+	char	*fileptr;
+	int	 fileLine;
+	int	 token;
+
+	if (!gx->fredModeLexing)
+		return(scanToken());
+	fileptr = gx->inptr;
+	fileLine = gx->currentLineNumber;
+	gx->inptr = gx->fredLexString;
+	token = scanToken();
+	gx->fredLexString = gx->inptr;
+	gx->inptr = fileptr;
+	gx->currentLineNumber = fileLine;
+	return(token);
+}
+
+/*
+	Decode the binary raw record at *pp, which runs no further than
+	'end', into a new object and step *pp past it.  Records of undefined
+	classes are reported and skipped; NULL means there are no more.
+	Offsets in messages are from 'start'.
+ */
+  object *
+decodeBinaryRecord(pp, end, start)
+  byte	**pp;
+  byte	 *end;
+  byte	 *start;
+{
+	object	*result;
+	byte	*p;
+	int	 length;
+	int	 size;
+
+	for (p = *pp; p + 3 <= end; p += 3 + length) {
+		length = (p[1] << 8) | p[2];
+		if (p + 3 + length > end)
+			break;
+		if (gx->classDefs[p[0] + 1] == NULL) {
+			error("\"%s\", offset %ld: undefined class %d\n",
+				gx->currentFileName, (long)(p - start), p[0]);
+			continue;
+		}
+		size = gx->classDefs[p[0] + 1]->size;
+		if (length != size)
+			error("\"%s\", offset %ld: class %d record is %d "
+				"bytes, not %d\n", gx->currentFileName,
+				(long)(p - start), p[0], length, size);
+		result = typeAlloc(object);
+		result->class = p[0];
+		result->stateVector = byteAlloc(size);
+		if (length < size) {
+			memcpy(result->stateVector, p + 3, length);
+			memset(result->stateVector + length, 0, size - length);
+		} else
+			memcpy(result->stateVector, p + 3, size);
+		*pp = p + 3 + length;
+		return(result);
+	}
+	if (p < end)
+		error("\"%s\", offset %ld: binary raw record truncated\n",
+			gx->currentFileName, (long)(p - start));
+	*pp = end;
+	return(NULL);
+}
 
-char yytext[256];
+/*
+	Next token from a binary raw file.  Each record comes out as a
+	Rawline just as its hex text form would.
+ */
+  static int
+binaryToken()
+{
+	fileList	*source;
+	object		*result;
+	byte		*p;
+	byte		 header[BINARY_RAW_HEADER];
+	char		 c;
+
+	source = gx->inputStack;
+	p = (byte *)gx->inptr;
+	if (p <= (byte *)source->buffer + 1) {
+		binaryRawHeader(header);
+		if (memcmp(source->buffer, header, BINARY_RAW_HEADER) != 0)
+			error("\"%s\": binary raw file from other defines\n",
+				gx->currentFileName);
+		p = (byte *)source->buffer + BINARY_RAW_HEADER;
+	}
+	result = decodeBinaryRecord(&p, (byte *)source->bufferEnd,
+		(byte *)source->buffer);
+	gx->inptr = (char *)p;
+	if (result != NULL) {
+		gx->yylval->rawObject = result;
+		return(Rawline);
+	}
+	if ((c = nextInput()) == 0)
+		return(0);
+	unput(c);
+	return(scanToken());
+}
 
-yylex()
+  static int
+scanToken()
 {
 	char	c;
+	int	token;
 
 	for (;;) {
+		if (gx->inputStack != NULL && gx->inputStack->binary &&
+				!gx->fredModeLexing)
+			return(binaryToken());
 		c = input();
-		oldnewline = newline;
-		newline = FALSE;
+		gx->oldnewline = gx->newline;
+		gx->newline = FALSE;
 		switch (char_type[c]) {
 			Case C_SLASH:
-				if (oldnewline) {
+				if (gx->oldnewline) {
 					parseRawline();
 					return(Rawline);
 				}
@@ -124,9 +255,9 @@ yylex()
 
 			Case C_ALPH:
 				parseName(c);
-				if ((yylval = matchKeyword(yytext)) != 0)
-					return(yylval);
-				yylval = lookupSymbol(yytext);
+				if ((token = matchKeyword(gx->yytext)) != 0)
+					return(token);
+				gx->yylval->name = lookupSymbol(gx->yytext);
 /*				  if (debug)
 				     printf("lexer: Name '%s'\n", yytext);*/
 				 return(Name);
@@ -152,7 +283,7 @@ yylex()
 				return(litCode[c]);
 
 			Case C_NL:
-				newline = TRUE;
+				gx->newline = TRUE;
 		}
 	}
 }
@@ -162,7 +293,7 @@ parseName(c)
 {
 	char	*cptr;
 
-	cptr = yytext;
+	cptr = gx->yytext;
 	while (char_type[c] == C_DIG || char_type[c] == C_ALPH) {
 		*cptr++ = c;
 		c = input();
@@ -190,9 +321,10 @@ parseNumber(base, c)
   int	base;
   char  c;
 {
-	yylval = 0;
+	gx->yylval->number = 0;
 	while (isDigit(c, base)) {
-		yylval = yylval * base + digitValue(c);
+		gx->yylval->number = gx->yylval->number * base +
+			digitValue(c);
 		c = input();
 	}
 	unput(c);
@@ -200,79 +332,139 @@ parseNumber(base, c)
 		printf("lexer: Number (%d) = %d\n", base, yylval);*/
 }
 
-skipToEol()
-{
-	char	c;
+#define XX	-1
+
+/* value of each hex digit character, XX for everything else */
+static signed char hexValue[256] = {
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, XX, XX, XX, XX, XX, XX,
+	XX, 10, 11, 12, 13, 14, 15, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, 10, 11, 12, 13, 14, 15, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX
+};
 
-	while ((c = input()) != '\n' && c != 0)
-		;
-	unput(c);
+/*
+	Skip the spaces and backslash escapes (a backslash hides whatever
+	follows it, which is how a raw line is continued) that may separate
+	hex byte pairs.
+ */
+  static char *
+skipHexSeparators(p)
+  char	*p;
+{
+	for (;;) {
+		if (*p == ' ')
+			++p;
+		else if (*p == '\\' && p[1] != '\0') {
+			if (p[1] == '\n')
+				++gx->currentLineNumber;
+			p += 2;
+		} else
+			return(p);
+	}
 }
 
-  int
-getHexByte()
+/*
+	Skip the rest of a bad raw line, continuations and all.
+ */
+  static void
+skipRawline()
 {
-	char	c1, c2;
+	char	*p;
 
-	while ((c1 = input()) == '\\' || c1 == ' ')
-		if (c1 == '\\')
-			c1 = input();
-	if (c1 == '\n' || c1 == 0) {
-		unput(c1);
-		return(-1);
-	} else if (!isDigit(c1, 16)) {
-		error("illegal hex digit '%c'\n", c1);
-		skipToEol();
-		return(-2);
-	}
-	c2 = input();
-	if (c2 == '\n' || c2 == 0) {
-		unput(c1);
-		error("bad hex digit parity\n");
-		return(-2);
-	} else if (!isDigit(c2, 16)) {
-		error("illegal hex digit '%c'\n", c2);
-		skipToEol();
-		return(-2);
-	}
-	return(digitValue(c1) * 16 + digitValue(c2));
+	for (p = gx->inptr; *p != '\n' && *p != '\0'; ++p)
+		if (*p == '\\' && p[1] != '\0')
+			if (*++p == '\n')
+				++gx->currentLineNumber;
+	gx->inptr = p;
 }
 
-getHexString(buf, size)
+  static void
+rawlineError(msg, c, i)
+  char	*msg;
+  char	 c;
+  int	 i;
+{
+	error("\"%s\", line %d: %s '%s' at byte %d of raw line\n",
+		gx->currentFileName, gx->currentLineNumber, msg, escape(c), i);
+}
+
+/*
+	Decode 'size' bytes of hex straight out of the input buffer into
+	'buf'.  A raw line that ends early or goes bad is padded out with
+	zeros, and the rest of a bad one is skipped.
+ */
+decodeHexString(buf, size)
   byte	*buf;
   int	 size;
 {
-	int	i;
-	int	aByte;
-	char	c;
+	char	*p;
+	int	 hi, lo;
+	int	 i;
 
-	for (i=0; i<size; ++i) {
-		aByte = getHexByte();
-		if (aByte < 0) break;
-		buf[i] = aByte;
+	p = gx->inptr;
+	for (i=0; i<size; ) {
+		if ((hi = hexValue[(byte)p[0]]) >= 0 &&
+				(lo = hexValue[(byte)p[1]]) >= 0) {
+			buf[i++] = (hi << 4) | lo;
+			p += 2;
+		} else if (*p == ' ' || *p == '\\') {
+			p = skipHexSeparators(p);
+		} else
+			break;
 	}
-	if (aByte < 0) {
-		error("raw line short\n");
-		for (; i<size; ++i)
-			buf[i] = 0;
-	} else if (getHexByte() >= 0) {
-		error("raw line long\n");
-		skipToEol();
+	gx->inptr = p;
+	if (i < size) {
+		if (*p == '\n' || *p == '\0')
+			error("\"%s\", line %d: raw line short, %d of %d "
+				"bytes\n", gx->currentFileName,
+				gx->currentLineNumber, i, size);
+		else if (hexValue[(byte)*p] >= 0) {
+			gx->inptr = p + 1;
+			if (p[1] == '\n' || p[1] == '\0')
+				rawlineError("unpaired hex digit", *p, i);
+			else
+				rawlineError("illegal hex digit", p[1], i);
+			skipRawline();
+		} else {
+			rawlineError("illegal hex digit", *p, i);
+			skipRawline();
+		}
+		memset(buf + i, 0, size - i);
+	} else {
+		gx->inptr = skipHexSeparators(p);
+		if (*gx->inptr != '\n' && *gx->inptr != '\0') {
+			error("\"%s\", line %d: raw line long, over %d "
+				"bytes\n", gx->currentFileName,
+				gx->currentLineNumber, size);
+			skipRawline();
+		}
 	}
 }
 
 parseRawline()
 {
 	object	*result;
-	char	 hexString[1500];
-	int	 length;
+	int	 size;
 
 	result = typeAlloc(object);
 	parseNumber(10, input());
-	result->class = yylval;
-	result->stateVector = (byte *)malloc(classDefs[yylval+1]->size);
-	getHexString(result->stateVector, classDefs[yylval+1]->size);
-	yylval = (int)result;
+	result->class = gx->yylval->number;
+	size = gx->classDefs[result->class+1]->size;
+	result->stateVector = (byte *)malloc(size);
+	decodeHexString(result->stateVector, size);
+	gx->yylval->rawObject = result;
 /*	if (debug)
 		printf("lexer: Rawline class=%d addr=%x\n", result->class, result);*/
 }
@@ -375,8 +567,9 @@ escape(c)
   char	c;
 {
 	int	i;
-	static char result[5];
+	char	*result;
 
+	result = gx->escapeBuffer;
 	if (' ' <= c && c <= '~')
 		sprintf(result, "%c", c);
 	else if (c == 0)
@@ -398,7 +591,7 @@ lexString(end)
 	char	*str;
 	char	 c;
 
-	str = yytext;
+	str = gx->yytext;
 	for (c = input(); c != end; c = input())
 		if (c == '\\')
 			*str++ = unescape();
@@ -411,11 +604,10 @@ string()
 {
 	int	 len;
 	char	*str;
-	char	*inptr;
 
-	str = malloc(strlen(yytext) + 1);
-	yylval = (int)str;
-	strcpy(str, yytext);
+	str = malloc(strlen(gx->yytext) + 1);
+	gx->yylval->string = str;
+	strcpy(str, gx->yytext);
 /*	if (debug)
 		printf("lexer: String '%s'\n", yylval);*/
 }
@@ -426,118 +618,71 @@ bitString()
 	byte	*str;
 	int	 i;
 
-	len = strlen(yytext);
+	len = strlen(gx->yytext);
 	str = (byte *)malloc(((len+7) >> 3) + 1);
-	yylval = (int)str;
+	gx->yylval->bitString = str;
 	*str++ = len;
 	for (i=0; i<((len+7) >> 3); ++i)
 		str[i] = 0;
 	for (i=0; i<len; ++i)
-		str[i>>3] |= (yytext[i] == '0' ? 0 : 1) << (7 - (i&7));
+		str[i>>3] |= (gx->yytext[i] == '0' ? 0 : 1) << (7 - (i&7));
 /*	if (debug)
 		printf("lexer: BitString, length=%d\n", len);*/
 }
 
-static char  lineBuf[500] = "";
-static char *inptr = lineBuf;
-static char  ungot;
-static boolean	ungetFlag = FALSE;
-
-purgeUnget()
-{
-	ungetFlag = FALSE;
-}
-
-input()
+/*
+	Out of line half of input(), reached when the scan hits a NUL.  At the
+	end of a buffer, drop back to whatever source comes next on the input
+	stack; a NUL inside a buffer is skipped.
+ */
+  char
+nextInput()
 {
-	char		 result;
 	fileList	*oldInputStack;
 
-	if (fredModeLexing)
-		return(*fredLexString++);
-	else if (ungetFlag) {
-		ungetFlag = FALSE;
-		return(ungot);
-	}
-	result = *inptr++;
-	if (result == '\0') {
-		if (fgets(lineBuf, 500, currentInput) == NULL) {
-			result = EOF;
-			--inptr;
-		} else {
-			inptr = lineBuf;
-#ifndef FRED
-			if (indirFile != NULL)
-				replaceParams(lineBuf);
-#endif
-			result = *inptr++;
-		}
+	if (gx->fredModeLexing || gx->inputStack == NULL)
+		return(0);
+	if (gx->inptr < gx->inputStack->bufferEnd) {
+		++gx->inptr;
+		return(input());
 	}
-	if (result == '\n')
-		++currentLineNumber;
-	else if (result == EOF) {
-		oldInputStack = inputStack;
-		inputStack = inputStack->next;
-		free(oldInputStack);
-		ungetFlag = FALSE;
-		if (announceIncludes) {
-			fprintf(stderr, "<-\n");
-			fflush(stderr);
-		}
-		fclose(currentInput);
-		if (inputStack == NULL) {
-/*			if (debug) printf("in(EOF)\n");*/
-			return(0);
-		} else {
-			currentInput = inputStack->fyle;
-			currentFileName = inputStack->saveName;
-			if (currentInput == NULL) {
-				if (strcmp(inputStack->saveName, "-") == 0) {
-					currentInput = stdin;
-					currentFileName = "<standard input>";
-				} else if ((currentInput = fopen(inputStack->
-						saveName, "r")) == NULL) {
-				     systemError("can't open input file %s\n",
-					inputStack->saveName);
-				}
-				inputStack->fyle = currentInput;
-			}
-			currentLineNumber = inputStack->saveLine;
-			return(input());
-		}
+	oldInputStack = gx->inputStack;
+	gx->inputStack = gx->inputStack->next;
+	releaseInputSource(oldInputStack);
+	if (gx->announceIncludes) {
+		fprintf(stderr, "<-\n");
+		fflush(stderr);
 	}
-/*	if (debug) printf("in(%c)\n", result);*/
-	return(result);
-}
-
-unput(c)
-  char	c;
-{
-/*	if (debug) printf("un(%c)\n", c);*/
-	if (fredModeLexing)
-		--fredLexString;
-	else {
-		ungetFlag = TRUE;
-		ungot = c;
+	if (gx->inputStack == NULL) {
+		gx->inptr = "";
+/*		if (debug) printf("in(EOF)\n");*/
+		return(0);
 	}
+	if (!loadInputSource(gx->inputStack))
+		systemError("can't open input file %s\n",
+			gx->inputStack->saveName);
+	gx->inptr = gx->inputStack->savePtr;
+	gx->currentFileName = gx->inputStack->saveName;
+	gx->currentLineNumber = gx->inputStack->saveLine;
+	return(input());
 }
 
+/* A '/' marks the shortest abbreviation of a keyword that is accepted. */
 static struct {
 	char	*string;
 	int	 token;
-	int	 minlength;
 } keywords[] = {
-/*0*/	"a",	      A,         0,	"ava/id",     AVAID,     0,
-/*2*/	"bin15",      BIN15,     0,	"bin31",      BIN31,     0,
-/*4*/	"bit",        BIT,       0,	"byte",       BYTE,      0,
-/*6*/	"ch/aracter", CHARACTER, 0,	"de/fine",    DEFINE,    0,
-/*8*/	"endd/efine", ENDDEFINE, 0,	"ent/ity",    ENTITY,    0,
-/*10*/	"fat/word",   FATWORD,   0,	"include",    INCLUDE,   0,
-/*12*/	"int/eger",   BIN15,     0,	"lo/ng",      BIN31,     0,
-/*14*/	"o",	      O,	 0,	"obj/id",     OBJID,     0,
-/*16*/	"r",	      R,	 0,	"reg/id",     REGID,     0,
-/*18*/	"use",	      USE,	 0,     "var/string", VARSTRING, 0,
-/*20*/	"wo/rds",     WORDS,     0,	NULL,         0,         0
+/*0*/	"a",	      A,		"ava/id",     AVAID,
+/*2*/	"bin15",      BIN15,		"bin31",      BIN31,
+/*4*/	"bit",        BIT,		"byte",       BYTE,
+/*6*/	"ch/aracter", CHARACTER,	"de/fine",    DEFINE,
+/*8*/	"endd/efine", ENDDEFINE,	"ent/ity",    ENTITY,
+/*10*/	"fat/word",   FATWORD,		"include",    INCLUDE,
+/*12*/	"int/eger",   BIN15,		"lo/ng",      BIN31,
+/*14*/	"o",	      O,		"obj/id",     OBJID,
+/*16*/	"r",	      R,		"reg/id",     REGID,
+/*18*/	"use",	      USE,		"var/string", VARSTRING,
+/*20*/	"wo/rds",     WORDS,		NULL,         0
 };
 
 static int keystart[26] = {
@@ -556,22 +701,23 @@ static int keyend[26] = {
 	/* z */ -1 };
 	
 
-setKeywordMinlengths()
+  boolean
+keywordMatches(s, keyword)
+  char	*s;
+  char	*keyword;
 {
-	char	*trailer;
-	char	*index();
-	int	 i;
+	boolean	 abbreviable;
 
-	for (i = 0; keywords[i].string != NULL; ++i) {
-		keywords[i].string = strdup(keywords[i].string);
-		trailer = index(keywords[i].string, '/');
-		if (trailer == NULL) {
-			keywords[i].minlength = strlen(keywords[i].string);
-		} else {
-			keywords[i].minlength = trailer - keywords[i].string;
-			strcpy(trailer, trailer + 1);
+	abbreviable = FALSE;
+	for (; *s != '\0'; ++s, ++keyword) {
+		if (*keyword == '/') {
+			abbreviable = TRUE;
+			++keyword;
 		}
+		if (*s != *keyword)
+			return(FALSE);
 	}
+	return(abbreviable || *keyword == '\0' || *keyword == '/');
 }
 
   int
@@ -580,15 +726,12 @@ matchKeyword(s)
 {
 	register int i;
 	register int firstc;
-	int len;
 
 	firstc = *s - 'a';
 	if (firstc < 0 || 25 < firstc || keystart[firstc] == -1)
 		return(0);
-	len = strlen(s);
 	for (i = keystart[firstc]; i <= keyend[firstc]; ++i) {
-		if (len >= keywords[i].minlength &&
-				strncmp(s, keywords[i].string, len) == 0)
+		if (keywordMatches(s, keywords[i].string))
 			return(keywords[i].token);
 	}
 	return(0);
@@ -0,0 +1,248 @@
+/*
+	The link to Reno.
+
+	Fred hands everything it sends down the link to a worker thread
+	through a queue, so the screen keeps taking keys while the emulator
+	works through a command and its settling time.  Jobs run strictly in
+	the order queued.  Writes, continues and pauses return at once; a
+	read waits until it and everything queued before it is done, since
+	the caller needs the bytes.  Until startLink() is called (and always
+	with -t) the calls go straight to the link instead.
+
+	Only the thread that called startLink() may queue jobs.
+ */
+
+#include "griddleDefs.h"
+#include "prot.h"
+#include <pthread.h>
+#include <unistd.h>
+
+typedef enum {
+	LINK_DOWN, LINK_UP, LINK_CONT, LINK_PAUSE
+} linkJobType;
+
+typedef struct linkJobStruct {
+	struct linkJobStruct	*next;
+	linkJobType		 type;
+	byte			*buf;
+	word			 length;
+	word			 addr;
+	boolean			 done;
+} linkJob;
+
+static pthread_t	 worker;
+static pthread_mutex_t	 linkLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	 linkQueued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t	 linkDone = PTHREAD_COND_INITIALIZER;
+static boolean		 linkRunning = FALSE;
+static linkJob		*firstJob = NULL;
+static linkJob		*lastJob = NULL;
+static int		 jobsPending = 0;
+static int		 jobsBusy = 0;
+static int		 jobsDone = 0;
+static double		 waitTime = 0.0;
+static double		 emulatorTime = 0.0;
+
+  static double
+now()
+{
+	struct timespec	t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return(t.tv_sec + t.tv_nsec / 1e9);
+}
+
+  static void
+runLinkJob(job)
+  linkJob	*job;
+{
+	switch (job->type) {
+		Case LINK_DOWN:  down(job->buf, job->length, job->addr);
+		Case LINK_UP:    up(job->buf, job->length, job->addr);
+		Case LINK_CONT:  Cont();
+		Case LINK_PAUSE: sleep(job->length);
+	}
+}
+
+  static void *
+linkWorker(arg)
+  void	*arg;
+{
+	linkJob	*job;
+
+	pthread_mutex_lock(&linkLock);
+	for (;;) {
+		while (firstJob == NULL)
+			pthread_cond_wait(&linkQueued, &linkLock);
+		job = firstJob;
+		--jobsPending;
+		jobsBusy = 1;
+		pthread_mutex_unlock(&linkLock);
+		runLinkJob(job);
+		pthread_mutex_lock(&linkLock);
+		if ((firstJob = job->next) == NULL)
+			lastJob = NULL;
+		jobsBusy = 0;
+		++jobsDone;
+		if (job->type == LINK_UP) {
+			job->done = TRUE;
+		} else {
+			free(job->buf);
+			free(job);
+		}
+		pthread_cond_broadcast(&linkDone);
+	}
+	return(NULL);
+}
+
+  void
+startLink()
+{
+	if (pthread_create(&worker, NULL, linkWorker, NULL) != 0)
+		error("can't start link thread\n");
+	else
+		linkRunning = TRUE;
+}
+
+/*
+	Queue a job, or run it on the spot if there is no worker.
+ */
+  static void
+queueLinkJob(type, buf, length, addr)
+  linkJobType	 type;
+  byte		*buf;
+  word		 length;
+  word		 addr;
+{
+	linkJob	*job;
+	linkJob	 direct;
+	double	 start;
+
+	if (type == LINK_PAUSE)
+		emulatorTime += length;
+	if (!linkRunning) {
+		direct.type = type;
+		direct.buf = buf;
+		direct.length = length;
+		direct.addr = addr;
+		start = now();
+		runLinkJob(&direct);
+		waitTime += now() - start;
+		return;
+	}
+	job = typeAlloc(linkJob);
+	job->next = NULL;
+	job->type = type;
+	job->length = length;
+	job->addr = addr;
+	job->done = FALSE;
+	if (type == LINK_DOWN) {
+		job->buf = (byte *)malloc(length);
+		memcpy(job->buf, buf, length);
+	} else
+		job->buf = buf;
+	pthread_mutex_lock(&linkLock);
+	if (lastJob == NULL)
+		firstJob = job;
+	else
+		lastJob->next = job;
+	lastJob = job;
+	++jobsPending;
+	pthread_cond_signal(&linkQueued);
+	if (type == LINK_UP) {
+		start = now();
+		while (!job->done)
+			pthread_cond_wait(&linkDone, &linkLock);
+		free(job);
+		waitTime += now() - start;
+	}
+	pthread_mutex_unlock(&linkLock);
+}
+
+  void
+linkDown(buf, length, addr)
+  byte	*buf;
+  word	 length;
+  word	 addr;
+{
+	queueLinkJob(LINK_DOWN, buf, length, addr);
+}
+
+  void
+linkUp(buf, length, addr)
+  byte	*buf;
+  word	 length;
+  word	 addr;
+{
+	queueLinkJob(LINK_UP, buf, length, addr);
+}
+
+  void
+linkCont()
+{
+	queueLinkJob(LINK_CONT, NULL, (word) 0, (word) 0);
+}
+
+/*
+	Give Reno 'seconds' to act on what it was just sent before sending
+	it anything more.
+ */
+  void
+linkPause(seconds)
+  int	seconds;
+{
+	queueLinkJob(LINK_PAUSE, NULL, (word) seconds, (word) 0);
+}
+
+/*
+	Wait until everything queued has been sent.
+ */
+  void
+linkWait()
+{
+	double	start;
+
+	if (!linkRunning)
+		return;
+	start = now();
+	pthread_mutex_lock(&linkLock);
+	while (firstJob != NULL)
+		pthread_cond_wait(&linkDone, &linkLock);
+	pthread_mutex_unlock(&linkLock);
+	waitTime += now() - start;
+}
+
+/*
+	Hand back, and start again from zero, the time spent waiting on the
+	link and the settling time asked of Reno (by linkPause()) since
+	last time.
+ */
+  void
+linkTimes(waitptr, emulatorptr)
+  double	*waitptr;
+  double	*emulatorptr;
+{
+	*waitptr = waitTime;
+	*emulatorptr = emulatorTime;
+	waitTime = emulatorTime = 0.0;
+}
+
+/*
+	Report the jobs waiting, being worked on and finished so far.
+	Returns FALSE if there is no worker to report on.
+ */
+  boolean
+linkStatus(pendingptr, busyptr, doneptr)
+  int	*pendingptr;
+  int	*busyptr;
+  int	*doneptr;
+{
+	if (!linkRunning)
+		return(FALSE);
+	pthread_mutex_lock(&linkLock);
+	*pendingptr = jobsPending;
+	*busyptr = jobsBusy;
+	*doneptr = jobsDone;
+	pthread_mutex_unlock(&linkLock);
+	return(TRUE);
+}
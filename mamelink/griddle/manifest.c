@@ -0,0 +1,292 @@
+/*
+	Incremental indirect builds.
+
+	When griddle is given -m with an indirect file, it keeps a manifest
+	alongside the world it builds.  For each region the manifest records
+	a hash of everything the region's output depends on -- its template
+	text, the text of anything it includes, its arguments, the global
+	IDs it is assigned (see ledger.c) and the IDs of the regions it
+	connects to -- along with the gri and raw output the region
+	produced.  On the next build any region whose hash has not changed is
+	copied straight out of the old manifest instead of being parsed
+	again.
+
+	The hash doesn't cover symbols a region takes from the regions
+	before it, and a region that is copied doesn't set the symbols it
+	would have.  So a region that assigns a variable, tags an object or
+	defines a class is marked in the manifest, and if the old manifest
+	has such a region nothing is copied; nor is anything after such a
+	region in the current build.
+ */
+
+#include "griddleDefs.h"
+
+#define MANIFEST_MAGIC "griddle manifest 2"
+#define manifestOptions() (gx->assignRelativeIds | (gx->binaryRaw << 1))
+
+typedef struct manifestEntryStruct {
+	unsigned long			 identHash;
+	unsigned long			 keyHash;
+	int				 griLength;
+	int				 rawLength;
+	boolean				 setsSymbols;
+	char				*griText;
+	char				*rawText;
+	boolean				 used;
+	struct manifestEntryStruct	*next;
+} manifestEntry;
+
+  static unsigned long
+hashFile(filename)
+  char	*filename;
+{
+	FILE		*fyle;
+	byte		 buf[4096];
+	int		 count;
+	unsigned long	 result;
+
+	result = HASH_START;
+	if ((fyle = fopen(filename, "r")) == NULL)
+		return(result);
+	while ((count = fread(buf, 1, sizeof(buf), fyle)) > 0)
+		result = hashBytes(result, buf, count);
+	fclose(fyle);
+	return(result);
+}
+
+  static unsigned long
+regionKey(reg)
+  int	reg;
+{
+	indirectEntry	*entry;
+	unsigned long	 result;
+	int		 i;
+
+	entry = &gx->indirTable[reg];
+	result = hashInt(HASH_START, entry->templateHash);
+	result = hashInt(result, entry->includeHash);
+	result = hashInt(result, entry->idCount);
+	if (entry->ids == NULL)
+		result = hashInt(result, entry->idBase);
+	else for (i=0; i<entry->idCount; ++i)
+		result = hashInt(result, entry->ids[i]);
+	result = hashInt(result, entry->rot);
+	result = hashInt(result, getIdent(entry->west));
+	result = hashInt(result, getIdent(entry->north));
+	result = hashInt(result, getIdent(entry->east));
+	result = hashInt(result, getIdent(entry->south));
+	for (i=0; i<entry->multiCount; ++i)
+		result = hashInt(result, getIdent(entry->multi[i]));
+	return(result);
+}
+
+  static char *
+readChunk(fyle, length)
+  FILE	*fyle;
+  int	 length;
+{
+	char	*result;
+
+	if (length < 0)
+		return(NULL);
+	result = malloc(length + 1);
+	if (fread(result, 1, length, fyle) != length) {
+		free(result);
+		return(NULL);
+	}
+	return(result);
+}
+
+  static void
+writeEntry(identHash, keyHash, setsSymbols, griText, griLength, rawText,
+    rawLength)
+  unsigned long	 identHash;
+  unsigned long	 keyHash;
+  boolean	 setsSymbols;
+  char		*griText;
+  int		 griLength;
+  char		*rawText;
+  int		 rawLength;
+{
+	fprintf(gx->newManifest, "region %08lx %08lx %d %d %d\n", identHash,
+		keyHash, setsSymbols, griLength, rawLength);
+	if (griLength > 0)
+		fwrite(griText, 1, griLength, gx->newManifest);
+	if (rawLength > 0)
+		fwrite(rawText, 1, rawLength, gx->newManifest);
+}
+
+/*
+	Read the manifest left by the previous build, if there is one and it
+	was made from the same defines and options, and start writing the new
+	one next to it.
+ */
+  void
+openManifest()
+{
+	FILE		*fyle;
+	char		 line[100];
+	unsigned long	 definesHash;
+	unsigned long	 oldDefinesHash;
+	int		 oldOptions;
+	manifestEntry	*entry;
+	manifestEntry	*last;
+	int		 setsSymbols;
+	char		*definesName;
+	char		*getenv();
+
+	if ((definesName = getenv("GHUDEFINES")) == NULL)
+		definesName = "defines.ghu";
+	definesHash = hashFile(definesName);
+
+	gx->oldManifest = last = NULL;
+	if ((fyle = fopen(gx->manifestName, "r")) != NULL) {
+		if (fgets(line, sizeof(line), fyle) != NULL &&
+		    strncmp(line, MANIFEST_MAGIC, strlen(MANIFEST_MAGIC)) == 0 &&
+		    fscanf(fyle, "defines %lx\n", &oldDefinesHash) == 1 &&
+		    fscanf(fyle, "options %d\n", &oldOptions) == 1 &&
+		    oldDefinesHash == definesHash &&
+		    oldOptions == manifestOptions()) {
+			for (;;) {
+				entry = typeAlloc(manifestEntry);
+				if (fscanf(fyle, "region %lx %lx %d %d %d\n",
+					    &entry->identHash, &entry->keyHash,
+					    &setsSymbols, &entry->griLength,
+					    &entry->rawLength) != 5) {
+					free(entry);
+					break;
+				}
+				entry->setsSymbols = setsSymbols;
+				if (entry->setsSymbols)
+					gx->noReuse = TRUE;
+				entry->griText = readChunk(fyle,
+					entry->griLength);
+				entry->rawText = readChunk(fyle,
+					entry->rawLength);
+				if (entry->griText == NULL)
+					entry->griLength = -1;
+				if (entry->rawText == NULL)
+					entry->rawLength = -1;
+				entry->used = FALSE;
+				entry->next = NULL;
+				if (last == NULL)
+					gx->oldManifest = entry;
+				else
+					last->next = entry;
+				last = entry;
+			}
+		}
+		fclose(fyle);
+	}
+
+	gx->newManifestName = malloc(strlen(gx->manifestName) + 5);
+	sprintf(gx->newManifestName, "%s.new", gx->manifestName);
+	if ((gx->newManifest = fopen(gx->newManifestName, "w")) == NULL)
+		systemError("can't open manifest file %s\n",
+			gx->newManifestName);
+	fprintf(gx->newManifest, "%s\n", MANIFEST_MAGIC);
+	fprintf(gx->newManifest, "defines %08lx\n", definesHash);
+	fprintf(gx->newManifest, "options %d\n", manifestOptions());
+}
+
+/*
+	If region 'reg' is unchanged since the last build, copy its output
+	from the old manifest and return TRUE.
+ */
+  boolean
+reuseRegion(reg)
+  int	reg;
+{
+	manifestEntry	*entry;
+	unsigned long	 identHash;
+	unsigned long	 keyHash;
+
+	if (gx->noReuse)
+		return(FALSE);
+	identHash = gx->indirTable[reg].identHash;
+	keyHash = regionKey(reg);
+	for (entry = gx->oldManifest; entry != NULL; entry = entry->next) {
+		if (entry->used || entry->identHash != identHash)
+			continue;
+		if (entry->keyHash != keyHash)
+			continue;
+		if ((gx->griFile != NULL && entry->griLength < 0) ||
+		    (gx->rawFile != NULL && entry->rawLength < 0))
+			continue;
+		entry->used = TRUE;
+		beginRawOutput();
+		if (gx->griFile != NULL)
+			fwrite(entry->griText, 1, entry->griLength,
+				gx->griFile);
+		if (gx->rawFile != NULL)
+			fwrite(entry->rawText, 1, entry->rawLength,
+				gx->rawFile);
+		writeEntry(identHash, keyHash, entry->setsSymbols,
+			entry->griText, entry->griLength, entry->rawText,
+			entry->rawLength);
+		return(TRUE);
+	}
+	return(FALSE);
+}
+
+  void
+beginRegionCapture()
+{
+	beginRawOutput();
+	gx->regionSetsSymbols = FALSE;
+	gx->saveGriFile = gx->griFile;
+	gx->saveRawFile = gx->rawFile;
+	if (gx->griFile != NULL)
+		gx->griFile = open_memstream(&gx->griBuffer, &gx->griSize);
+	if (gx->rawFile != NULL)
+		gx->rawFile = open_memstream(&gx->rawBuffer, &gx->rawSize);
+}
+
+/*
+	Pass the output captured for region 'reg' on to the real output
+	files and record it in the new manifest.  Regions that produced
+	errors are left out so that they are rebuilt next time.
+ */
+  void
+endRegionCapture(reg, oldErrorCount)
+  int	reg;
+  int	oldErrorCount;
+{
+	int	griLength;
+	int	rawLength;
+
+	griLength = rawLength = -1;
+	if (gx->griFile != NULL) {
+		fclose(gx->griFile);
+		griLength = gx->griSize;
+		fwrite(gx->griBuffer, 1, griLength, gx->saveGriFile);
+	}
+	if (gx->rawFile != NULL) {
+		fclose(gx->rawFile);
+		rawLength = gx->rawSize;
+		fwrite(gx->rawBuffer, 1, rawLength, gx->saveRawFile);
+	}
+	if (gx->errorCount == oldErrorCount)
+		writeEntry(gx->indirTable[reg].identHash, regionKey(reg),
+			gx->regionSetsSymbols, gx->griBuffer, griLength,
+			gx->rawBuffer, rawLength);
+	if (gx->regionSetsSymbols)
+		gx->noReuse = TRUE;
+	if (gx->griFile != NULL)
+		free(gx->griBuffer);
+	if (gx->rawFile != NULL)
+		free(gx->rawBuffer);
+	gx->griFile = gx->saveGriFile;
+	gx->rawFile = gx->saveRawFile;
+}
+
+  void
+closeManifest()
+{
+	if (fclose(gx->newManifest) != 0)
+		systemError("can't write manifest file %s\n",
+			gx->newManifestName);
+	if (rename(gx->newManifestName, gx->manifestName) != 0)
+		systemError("can't replace manifest file %s\n",
+			gx->manifestName);
+}
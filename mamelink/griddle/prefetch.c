@@ -0,0 +1,201 @@
+/*
+	Neighbour prefetch.
+
+	After fred loads a region it asks for the regions next to it to be
+	read in the background, so that walking to one of them finds it
+	already in the region cache.  The reading is done by a thread with a
+	griddleContext of its own, set up from the same defines and class
+	file as fred's, which keeps quiet about errors: a region that doesn't
+	read cleanly, even one that hits a fatal error, is dropped, and will
+	be read (and complained about) in the foreground if it is asked for.
+
+	Only fred's main thread calls in here.  Regions read are handed back
+	through takePrefetchedRegion(), to go into the cache on that thread.
+ */
+
+#include "griddleDefs.h"
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define MAXPREFETCH	4
+
+static pthread_t	 prefetcher;
+static pthread_mutex_t	 prefetchLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	 prefetchWanted = PTHREAD_COND_INITIALIZER;
+static boolean		 prefetcherRunning = FALSE;
+static char		*wanted[MAXPREFETCH];
+static int		 wantedCount = 0;
+static cachedRegion	*firstRead = NULL;
+static cachedRegion	*lastRead = NULL;
+static char		*definesName;
+static char		*classFileName;
+
+/*
+	Read region file 'name' (or archive region 'file#key') in the
+	prefetcher's context and take its objects away from the context.
+ */
+  static cachedRegion *
+readNeighbour(name)
+  char	*name;
+{
+	char		 fileName[80];
+	char		*key;
+	byte		*data;
+	int		 length;
+	struct stat	 statBuf;
+	cachedRegion	*region;
+	int		 i;
+	char		*index();
+	int		 yyparse();
+
+	strcpy(fileName, name);
+	if ((key = index(fileName, '#')) != NULL)
+		*key++ = '\0';
+	if (stat(fileName, &statBuf) != 0)
+		return(NULL);
+	gx->errorCount = 0;
+	if (key != NULL) {
+		if (!findArchiveRegion(fileName, key, &data, &length))
+			return(NULL);
+		resetRegionCounters();
+		loadArchiveRegion(data, length);
+	} else {
+		queueInputFile(saveString(fileName));
+		if (!openFirstFile(TRUE))
+			return(NULL);
+		resetRegionCounters();
+		yyparse();
+	}
+	if (gx->errorCount > 0 || gx->objectCount > 127 ||
+			!generateContentsVector())
+		return(NULL);
+	region = typeAlloc(cachedRegion);
+	region->fileName = saveString(name);
+	region->fileTime = statBuf.st_mtime;
+	region->fileSize = statBuf.st_size;
+	region->lastUsed = 0;
+	region->objectCount = gx->objectCount;
+	region->globalIdCounter = gx->globalIdCounter;
+	for (i=0; i<gx->objectCount; ++i) {
+		region->objects[i] = gx->noidArray[i];
+		gx->noidArray[i] = NULL;
+	}
+	memcpy(region->cv, gx->cv, gx->cvLength);
+	region->cvLength = gx->cvLength;
+	region->next = NULL;
+	return(region);
+}
+
+/*
+	A fatal error in the library, such as a missing include file, would
+	exit(); here it comes back to this function instead, and the region
+	is dropped.
+ */
+  static cachedRegion *
+prefetchRegion(name)
+  char	*name;
+{
+	jmp_buf		 fatal;
+	cachedRegion	*region;
+
+	if (setjmp(fatal) != 0) {
+		gx->fatalJump = NULL;
+		discardInput();
+		return(NULL);
+	}
+	gx->fatalJump = &fatal;
+	region = readNeighbour(name);
+	gx->fatalJump = NULL;
+	return(region);
+}
+
+  static void *
+prefetchWorker(arg)
+  void	*arg;
+{
+	char		*name;
+	cachedRegion	*region;
+	int		 yyparse();
+
+	useGriddleContext(newGriddleContext(TRUE));
+	gx->quiet = TRUE;
+	gx->classFileName = classFileName;
+	queueInputFile(definesName);
+	if (openFirstFile(TRUE))
+		yyparse();
+	readClassFile();
+
+	pthread_mutex_lock(&prefetchLock);
+	for (;;) {
+		while (wantedCount == 0)
+			pthread_cond_wait(&prefetchWanted, &prefetchLock);
+		name = wanted[0];
+		memmove(wanted, wanted + 1, --wantedCount * sizeof(char *));
+		pthread_mutex_unlock(&prefetchLock);
+		region = prefetchRegion(name);
+		free(name);
+		pthread_mutex_lock(&prefetchLock);
+		if (region != NULL) {
+			if (lastRead == NULL)
+				firstRead = region;
+			else
+				lastRead->next = region;
+			lastRead = region;
+		}
+	}
+	return(NULL);
+}
+
+  static boolean
+startPrefetcher()
+{
+	if ((definesName = getenv("GHUDEFINES")) == NULL)
+		definesName = "defines.ghu";
+	classFileName = gx->classFileName;
+	if (pthread_create(&prefetcher, NULL, prefetchWorker, NULL) != 0)
+		return(FALSE);
+	prefetcherRunning = TRUE;
+	return(TRUE);
+}
+
+/*
+	Ask for regions 'names' to be read, in place of any asked for before
+	that haven't been started on yet.
+ */
+  void
+prefetchRegions(names, count)
+  char	**names;
+  int	  count;
+{
+	int	i;
+
+	if (!prefetcherRunning && !startPrefetcher())
+		return;
+	pthread_mutex_lock(&prefetchLock);
+	for (i=0; i<wantedCount; ++i)
+		free(wanted[i]);
+	for (wantedCount=0; wantedCount<count && wantedCount<MAXPREFETCH;
+			++wantedCount)
+		wanted[wantedCount] = saveString(names[wantedCount]);
+	pthread_cond_signal(&prefetchWanted);
+	pthread_mutex_unlock(&prefetchLock);
+}
+
+/*
+	Return the next region the prefetcher has finished reading, or NULL
+	if there isn't one.
+ */
+  cachedRegion *
+takePrefetchedRegion()
+{
+	cachedRegion	*region;
+
+	if (!prefetcherRunning)
+		return(NULL);
+	pthread_mutex_lock(&prefetchLock);
+	if ((region = firstRead) != NULL)
+		if ((firstRead = region->next) == NULL)
+			lastRead = NULL;
+	pthread_mutex_unlock(&prefetchLock);
+	return(region);
+}
@@ -0,0 +1,324 @@
+/*
+	Phase profiling.
+
+	griddle -P file (or fred -P file) charges the time the compiler
+	spends to the phase it is in, innermost first: evaluating an
+	expression while filling in an object's fields counts as evaluation,
+	not as filling.  Whatever is not in any phase -- reading the class
+	file, the indirect file, and so on -- counts as 'other'.  At every
+	change of phase the time since the last change is also charged to
+	the current input file and, in an indirect build, to the region
+	being compiled.
+
+	Phases change hundreds of thousands of times in a big build, so a
+	change of phase only reads the wall clock.  The thread's CPU clock (a
+	system call) and the size of the malloc heap (a walk of every arena)
+	are only read when the file or region changes and at the end, and
+	are reported for files, regions and the whole run, not for phases.
+
+	Lexing is too fine grained even for that: switching phase for every
+	token cost more than the lexing did.  Instead one token in LEX_SAMPLE
+	is timed, and the sampled time, scaled up to all the tokens, is moved
+	from the phase the lexer was called from to 'lex'.  The lex phase's
+	entries are the number of tokens.
+
+	The report is written when the run ends, one tab separated record
+	per line, times in seconds:
+
+		phase	<name>	<entries>	<wall>
+		file	<name>	<wall>	<cpu>	<heap>
+		region	<number>	<template>	<wall>	<cpu>	<heap>
+		total	<wall>	<cpu>	<heap>
+
+	CPU time is that of the thread the context belongs to.  'heap' is
+	the net number of bytes the malloc heap grew by, which can be
+	negative.  The heap belongs to the whole process, so in fred, whose
+	prefetch and autosave threads allocate too, it is left out and
+	reported as 0.
+ */
+
+#include "griddleDefs.h"
+#include <malloc.h>
+
+#define LEX_SAMPLE	16
+
+static char	*phaseNames[PHASE_COUNT] = {
+	"other", "lex", "parse", "evaluate", "fill", "shift", "sort",
+	"output", "cv"
+};
+
+typedef struct profileEntryStruct {
+	struct profileEntryStruct	*next;
+	char				*name;
+	int				 number;
+	double				 wall;
+	double				 cpu;
+	long				 heap;
+} profileEntry;
+
+typedef struct profileStruct {
+	char		*fileName;
+	profilePhase	 phase;
+	double		 startWall;
+	double		 startCpu;
+	double		 lastWall;
+	double		 lastCpu;
+	long		 startHeap;
+	long		 lastHeap;
+	long		 lexTokens;
+	double		 lexPending;
+	long		 entries[PHASE_COUNT];
+	double		 wall[PHASE_COUNT];
+	profileEntry	*files;
+	profileEntry	*file;
+	char		*currentFileName;
+	profileEntry	*regions;
+	profileEntry	*region;
+} profile;
+
+  static double
+seconds(clock)
+  clockid_t	clock;
+{
+	struct timespec	now;
+
+	clock_gettime(clock, &now);
+	return(now.tv_sec + now.tv_nsec / 1e9);
+}
+
+  static profileEntry *
+newProfileEntry(list, name, number)
+  profileEntry	**list;
+  char		 *name;
+  int		  number;
+{
+	profileEntry	*entry;
+
+	entry = typeAlloc(profileEntry);
+	entry->name = saveString(name);
+	entry->number = number;
+	entry->wall = entry->cpu = 0.0;
+	entry->heap = 0;
+	entry->next = *list;
+	*list = entry;
+	return(entry);
+}
+
+  static long
+heapInUse()
+{
+	return(gx->fredMode ? 0 : (long)mallinfo2().uordblks);
+}
+
+/*
+	Charge the CPU time and heap growth since the last look to the
+	current file and region.
+ */
+  static void
+chargeCpuAndHeap(prof)
+  profile	*prof;
+{
+	double	cpu;
+	long	heap;
+
+	cpu = seconds(CLOCK_THREAD_CPUTIME_ID);
+	heap = heapInUse();
+	if (prof->file != NULL) {
+		prof->file->cpu += cpu - prof->lastCpu;
+		prof->file->heap += heap - prof->lastHeap;
+	}
+	if (prof->region != NULL) {
+		prof->region->cpu += cpu - prof->lastCpu;
+		prof->region->heap += heap - prof->lastHeap;
+	}
+	prof->lastCpu = cpu;
+	prof->lastHeap = heap;
+}
+
+/*
+	Charge the time since the last change to the current phase, less
+	the lexing done meanwhile, and to the current file and region.
+ */
+  static void
+chargeProfile(prof)
+  profile	*prof;
+{
+	double		 wall;
+	double		 lex;
+	profileEntry	*entry;
+
+	wall = seconds(CLOCK_MONOTONIC);
+	lex = prof->lexPending;
+	if (lex > wall - prof->lastWall)
+		lex = wall - prof->lastWall;
+	prof->lexPending = 0.0;
+	prof->wall[prof->phase] += wall - prof->lastWall - lex;
+	prof->wall[PHASE_LEX] += lex;
+	if (prof->file != NULL)
+		prof->file->wall += wall - prof->lastWall;
+	if (prof->region != NULL)
+		prof->region->wall += wall - prof->lastWall;
+	prof->lastWall = wall;
+	if (gx->currentFileName != prof->currentFileName) {
+		chargeCpuAndHeap(prof);
+		prof->currentFileName = gx->currentFileName;
+		prof->file = NULL;
+		if (prof->currentFileName != NULL) {
+			for (entry = prof->files; entry != NULL;
+					entry = entry->next)
+				if (strcmp(entry->name,
+						prof->currentFileName) == 0)
+					break;
+			if (entry == NULL)
+				entry = newProfileEntry(&prof->files,
+					prof->currentFileName, 0);
+			prof->file = entry;
+		}
+	}
+}
+
+  void
+openProfile(fileName)
+  char	*fileName;
+{
+	profile	*prof;
+
+	prof = (profile *)calloc(1, sizeof(profile));
+	prof->fileName = fileName;
+	prof->phase = PHASE_OTHER;
+	prof->startWall = prof->lastWall = seconds(CLOCK_MONOTONIC);
+	prof->startCpu = prof->lastCpu = seconds(CLOCK_THREAD_CPUTIME_ID);
+	prof->startHeap = prof->lastHeap = heapInUse();
+	gx->profile = prof;
+}
+
+/*
+	yylex() for a profiled context.
+ */
+  int
+profileLex()
+{
+	profile	*prof;
+	double	 start;
+	int	 token;
+
+	prof = gx->profile;
+	if (prof->lexTokens++ % LEX_SAMPLE != 0)
+		return(lexToken());
+	start = seconds(CLOCK_MONOTONIC);
+	token = lexToken();
+	prof->lexPending += (seconds(CLOCK_MONOTONIC) - start) * LEX_SAMPLE;
+	return(token);
+}
+
+/*
+	Use through PROFILE_ENTER(), which returns the phase to hand back
+	to PROFILE_LEAVE().  Entering the phase already current costs
+	nothing, so recursive functions can mark themselves.
+ */
+  profilePhase
+enterPhase(phase)
+  profilePhase	phase;
+{
+	profilePhase	previous;
+
+	previous = gx->profile->phase;
+	if (phase != previous) {
+		chargeProfile(gx->profile);
+		gx->profile->phase = phase;
+		++gx->profile->entries[phase];
+	}
+	return(previous);
+}
+
+  void
+leavePhase(previous)
+  profilePhase	previous;
+{
+	if (previous != gx->profile->phase) {
+		chargeProfile(gx->profile);
+		gx->profile->phase = previous;
+	}
+}
+
+/*
+	Start charging time to indirect region 'reg', or to no region if it
+	is negative.
+ */
+  void
+profileRegion(reg)
+  int	reg;
+{
+	if (gx->profile == NULL)
+		return;
+	chargeProfile(gx->profile);
+	chargeCpuAndHeap(gx->profile);
+	if (reg < 0)
+		gx->profile->region = NULL;
+	else
+		gx->profile->region = newProfileEntry(&gx->profile->regions,
+			gx->indirName, reg);
+}
+
+  static void
+writeProfileEntries(fyle, kind, entry)
+  FILE		*fyle;
+  char		*kind;
+  profileEntry	*entry;
+{
+	if (entry == NULL)
+		return;
+	writeProfileEntries(fyle, kind, entry->next);
+	if (strcmp(kind, "region") == 0)
+		fprintf(fyle, "region\t%d\t%s\t%.6f\t%.6f\t%ld\n",
+			entry->number, entry->name, entry->wall, entry->cpu,
+			entry->heap);
+	else
+		fprintf(fyle, "%s\t%s\t%.6f\t%.6f\t%ld\n", kind,
+			entry->name, entry->wall, entry->cpu, entry->heap);
+}
+
+  static void
+freeProfileEntries(entry)
+  profileEntry	*entry;
+{
+	profileEntry	*next;
+
+	for (; entry != NULL; entry = next) {
+		next = entry->next;
+		free(entry->name);
+		free(entry);
+	}
+}
+
+  void
+closeProfile()
+{
+	profile		*prof;
+	FILE		*fyle;
+	int		 i;
+
+	if ((prof = gx->profile) == NULL)
+		return;
+	chargeProfile(prof);
+	chargeCpuAndHeap(prof);
+	prof->entries[PHASE_LEX] = prof->lexTokens;
+	if (strcmp(prof->fileName, "-") == 0)
+		fyle = stderr;
+	else if ((fyle = fopen(prof->fileName, "w")) == NULL)
+		systemError("can't open profile file %s\n", prof->fileName);
+	for (i=0; i<PHASE_COUNT; ++i)
+		fprintf(fyle, "phase\t%s\t%ld\t%.6f\n", phaseNames[i],
+			prof->entries[i], prof->wall[i]);
+	writeProfileEntries(fyle, "file", prof->files);
+	writeProfileEntries(fyle, "region", prof->regions);
+	fprintf(fyle, "total\t%.6f\t%.6f\t%ld\n",
+		prof->lastWall - prof->startWall, prof->lastCpu - prof->startCpu,
+		prof->lastHeap - prof->startHeap);
+	if (fyle != stderr)
+		fclose(fyle);
+	freeProfileEntries(prof->files);
+	freeProfileEntries(prof->regions);
+	free(prof);
+	gx->profile = NULL;
+}
@@ -0,0 +1,247 @@
+/*
+	Resident compile server.
+
+	griddle -S socket parses the defines and loads the class file once,
+	then listens on a Unix domain socket.  Each connection carries one
+	compile request, handled in a child forked from the fully set up
+	server, so every request starts from a fresh copy of the defines no
+	matter what the previous one did to the symbol table.
+
+	A request is a series of lines:
+
+		format gri		(any of gri, raw and cv, in any order)
+		relative		(optional, same as -R)
+		file <path>		or	text <length>
+					followed by <length> bytes of source
+
+	The file or text line ends the request.  The reply has one section
+	per requested format, in the order they were asked for, then one for
+	the messages the compile produced and a status line:
+
+		gri <length>
+		<length bytes>
+		...
+		messages <length>
+		<length bytes>
+		status <error count>
+
+	A request that dies on a fatal error is still answered, with
+	whatever output it had got to and a nonzero status.
+ */
+
+#include "griddleDefs.h"
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define MAXREQUESTLINE	1000
+#define MAXFORMATS	3
+
+typedef enum {
+	FORMAT_GRI, FORMAT_RAW, FORMAT_CV
+} outputFormat;
+
+static char	*formatNames[] = { "gri", "raw", "cv" };
+
+  static void
+sendSection(reply, name, buf, length)
+  FILE	*reply;
+  char	*name;
+  char	*buf;
+  size_t length;
+{
+	fprintf(reply, "%s %ld\n", name, (long)length);
+	fwrite(buf, 1, length, reply);
+}
+
+  static boolean
+queueRequestText(request, length)
+  FILE	*request;
+  int	 length;
+{
+	char	*text;
+
+	text = malloc(length + 1);
+	if (length < 0 || fread(text, 1, length, request) != length) {
+		free(text);
+		return(FALSE);
+	}
+	text[length] = '\0';
+	queueInputFile("<request>");
+	gx->bottomOfInputStack->buffer = text;
+	gx->bottomOfInputStack->bufferEnd = text + length;
+	return(TRUE);
+}
+
+/*
+	What the request being served has to send back.  It is kept here
+	rather than in serveRequest() so that a compile that dies on a fatal
+	error, which exit()s, can still be answered, from the exit hook.
+ */
+static FILE		*reply;
+static outputFormat	 formats[MAXFORMATS];
+static int		 formatCount;
+static char		*buffers[MAXFORMATS];
+static size_t		 sizes[MAXFORMATS];
+static char		*messages;
+static size_t		 messageSize;
+static boolean		 replySent;
+
+  static void
+sendReply()
+{
+	int	i;
+
+	if (replySent)
+		return;
+	replySent = TRUE;
+	if (gx->griFile != NULL)
+		fclose(gx->griFile);
+	if (gx->rawFile != NULL)
+		fclose(gx->rawFile);
+	if (gx->cvFile != NULL)
+		fclose(gx->cvFile);
+	gx->griFile = gx->rawFile = gx->cvFile = NULL;
+	fflush(stderr);
+
+	for (i=0; i<formatCount; ++i)
+		sendSection(reply, formatNames[formats[i]], buffers[i],
+			sizes[i]);
+	sendSection(reply, "messages", messages, messageSize);
+	fprintf(reply, "status %d\n", gx->errorCount);
+	fclose(reply);
+}
+
+/*
+	Exit hook for the child: the compile hit a fatal error, which may not
+	have been counted, so make sure the status says it failed.
+ */
+  static void
+replyOnExit()
+{
+	if (gx->errorCount == 0)
+		gx->errorCount = 1;
+	sendReply();
+}
+
+/*
+	Read one request from 'fd', compile it and write back the results.
+	Runs in a child of the server, so it is free to scribble on the
+	context and the standard streams.
+ */
+  static void
+serveRequest(fd)
+  int	fd;
+{
+	FILE		*request;
+	char		 line[MAXREQUESTLINE];
+	char		*end;
+	boolean		 haveSource;
+	int		 i;
+	int		 yyparse();
+	char		*index();
+
+	request = fdopen(fd, "r");
+	reply = fdopen(dup(fd), "w");
+	stdout = stderr = open_memstream(&messages, &messageSize);
+	gx->griFile = gx->rawFile = gx->cvFile = NULL;
+	formatCount = 0;
+	replySent = FALSE;
+	atexit(replyOnExit);
+
+	haveSource = FALSE;
+	while (!haveSource && fgets(line, MAXREQUESTLINE, request) != NULL) {
+		if ((end = index(line, '\n')) != NULL)
+			*end = '\0';
+		if (strncmp(line, "format ", 7) == 0) {
+			for (i=0; i<MAXFORMATS; ++i)
+				if (strcmp(line + 7, formatNames[i]) == 0)
+					break;
+			if (i == MAXFORMATS)
+				error("unknown format '%s'\n", line + 7);
+			else if (formatCount < MAXFORMATS) {
+				buffers[formatCount] = NULL;
+				sizes[formatCount] = 0;
+				formats[formatCount++] = (outputFormat)i;
+			}
+		} else if (strcmp(line, "relative") == 0) {
+			gx->assignRelativeIds = TRUE;
+		} else if (strncmp(line, "file ", 5) == 0) {
+			queueInputFile(saveString(line + 5));
+			haveSource = TRUE;
+		} else if (strncmp(line, "text ", 5) == 0) {
+			if (!queueRequestText(request, atoi(line + 5)))
+				error("request text short\n");
+			else
+				haveSource = TRUE;
+		} else
+			error("bad request line '%s'\n", line);
+	}
+
+	for (i=0; i<formatCount; ++i) {
+		switch (formats[i]) {
+			Case FORMAT_GRI: gx->griFile =
+				open_memstream(&buffers[i], &sizes[i]);
+			Case FORMAT_RAW: gx->rawFile =
+				open_memstream(&buffers[i], &sizes[i]);
+			Case FORMAT_CV: gx->cvFile =
+				open_memstream(&buffers[i], &sizes[i]);
+		}
+	}
+	if (!haveSource)
+		error("request has no file or text\n");
+	else if (openFirstFile(FALSE)) {
+		yyparse();
+		if (gx->cvFile != NULL)
+			outputContentsVector();
+		flushNoidArray();
+	}
+	sendReply();
+	fclose(request);
+}
+
+/*
+	Called once the defines have been parsed and the class file read.
+	Never returns.
+ */
+  void
+serveRequests(socketName)
+  char	*socketName;
+{
+	struct sockaddr_un	 address;
+	int			 listener;
+	int			 fd;
+
+	if (strlen(socketName) >= sizeof(address.sun_path)) {
+		error("socket name %s too long\n", socketName);
+		exit(1);
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, socketName);
+	if ((listener = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+		systemError("can't create socket %s\n", socketName);
+	unlink(socketName);
+	if (bind(listener, (struct sockaddr *)&address, sizeof(address)) < 0)
+		systemError("can't bind socket %s\n", socketName);
+	if (listen(listener, 16) < 0)
+		systemError("can't listen on socket %s\n", socketName);
+	signal(SIGCHLD, SIG_IGN);
+	fflush(stdout);
+	fflush(stderr);
+
+	for (;;) {
+		if ((fd = accept(listener, NULL, NULL)) < 0)
+			continue;
+		switch (fork()) {
+			Case 0:
+				close(listener);
+				serveRequest(fd);
+				_exit(0);
+			Case -1:
+				error("can't fork for request\n");
+		}
+		close(fd);
+	}
+}
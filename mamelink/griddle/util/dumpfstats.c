@@ -1,6 +1,25 @@
+/*
+	dumpfstats [file ...]
+
+	Report on fred's command statistics (see ../fstats.h), adding up
+	all the files given.  An argument ending in / names the directory a
+	fredStats file is in, as in 'dumpfstats ~chip/ ~randy/'.
+	With no arguments the report is on ./fredStats.
+
+	Commands are listed costliest first, with the 50th, 90th and 99th
+	percentile times of a single run, in milliseconds, for each of the
+	local, wait and emulator times.  A percentile is the top of the
+	histogram bucket it falls in.
+ */
+
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../fstats.h"
 
-int fredStats[128];
+#define MAXSTATLINE	1000
+
+commandStats	fredStats[FSTATS_KEYS];
 
   char *
 keyName(key)
@@ -33,37 +52,144 @@ keyName(key)
 	return(result);
 }
 
+/*
+	Add the statistics in 'name' to fredStats[].
+ */
   void
-readFredStats(argc, argv)
-  int	 argc;
-  char	*argv[];
+readFredStats(name)
+  char	*name;
 {
-	FILE	*statFyle;
-	int	 i;
-	char	 temp[256];
-
-	if (argc > 1)
-		sprintf(temp, "%sfredStats", argv[1]);
-	else
-		strcpy(temp, "fredStats");
-	if ((statFyle = fopen(temp, "r")) != NULL) {
-		for (i=0; i<128; ++i)
-			fredStats[i] = getw(statFyle);
-		fclose(statFyle);
+	FILE		*statFyle;
+	char		 line[MAXSTATLINE];
+	char		 kind[20];
+	char		*p;
+	commandStats	*stats;
+	int		 key;
+	long		 count;
+	int		 i, j;
+
+	if ((statFyle = fopen(name, "r")) == NULL) {
+		fprintf(stderr, "can't open %s\n", name);
+		return;
 	}
-	if (statFyle == NULL || feof(statFyle)) {
-		for (i=0; i<128; ++i)
-			fredStats[i] = 0;
+	if (fgets(line, MAXSTATLINE, statFyle) == NULL ||
+			strncmp(line, FSTATS_MAGIC " ",
+			strlen(FSTATS_MAGIC) + 1) != 0) {
+		rewind(statFyle);
+		for (i=0; i<FSTATS_KEYS; ++i) {
+			count = getw(statFyle);
+			if (feof(statFyle))
+				break;
+			fredStats[i].count += count;
+		}
+	} else if (atoi(line + strlen(FSTATS_MAGIC)) != FSTATS_VERSION) {
+		fprintf(stderr, "%s is version %d, skipped\n", name,
+			atoi(line + strlen(FSTATS_MAGIC)));
+	} else {
+		stats = NULL;
+		while (fgets(line, MAXSTATLINE, statFyle) != NULL) {
+			if (sscanf(line, "key %d %ld", &key, &count) == 2) {
+				stats = 0 <= key && key < FSTATS_KEYS ?
+					&fredStats[key] : NULL;
+				if (stats != NULL)
+					stats->count += count;
+				continue;
+			}
+			if (stats == NULL || sscanf(line, "%19s", kind) != 1)
+				continue;
+			for (i=0; i<TIME_KINDS; ++i)
+				if (strcmp(kind, statTimeNames[i]) == 0)
+					break;
+			if (i == TIME_KINDS)
+				continue;
+			p = line + strlen(kind);
+			stats->total[i] += strtod(p, &p);
+			for (j=0; j<FSTATS_BUCKETS; ++j)
+				stats->histogram[i][j] += strtol(p, &p, 10);
+		}
 	}
+	fclose(statFyle);
+}
+
+  double
+percentile(histogram, fraction)
+  long		*histogram;
+  double	 fraction;
+{
+	long	runs;
+	long	seen;
+	int	i;
+
+	for (runs=0, i=0; i<FSTATS_BUCKETS; ++i)
+		runs += histogram[i];
+	if (runs == 0)
+		return(0.0);
+	for (seen=0, i=0; i<FSTATS_BUCKETS - 1; ++i)
+		if ((seen += histogram[i]) >= fraction * runs)
+			break;
+	return((1L << i) / 1000.0);
+}
+
+  double
+totalTime(stats)
+  commandStats	*stats;
+{
+	return(stats->total[TIME_LOCAL] + stats->total[TIME_WAIT]);
+}
+
+  int
+byCost(k1, k2)
+  int	*k1;
+  int	*k2;
+{
+	double	t1, t2;
+
+	t1 = totalTime(&fredStats[*k1]);
+	t2 = totalTime(&fredStats[*k2]);
+	if (t1 != t2)
+		return(t1 < t2 ? 1 : -1);
+	if (fredStats[*k1].count != fredStats[*k2].count)
+		return(fredStats[*k1].count < fredStats[*k2].count ? 1 : -1);
+	return(*k1 - *k2);
 }
 
 main(argc, argv)
   int	 argc;
   char	*argv[];
 {
-	int	i;
+	char	 name[256];
+	int	 keys[FSTATS_KEYS];
+	int	 i, j;
 
-	readFredStats(argc, argv);
-	for (i=0; i<128; ++i)
-		printf("%s -- %d\n", keyName(i), fredStats[i]);
+	if (argc < 2)
+		readFredStats("fredStats");
+	for (i=1; i<argc; ++i) {
+		if (argv[i][strlen(argv[i]) - 1] == '/')
+			sprintf(name, "%.240sfredStats", argv[i]);
+		else
+			sprintf(name, "%.255s", argv[i]);
+		readFredStats(name);
+	}
+	for (i=0; i<FSTATS_KEYS; ++i)
+		keys[i] = i;
+	qsort(keys, FSTATS_KEYS, sizeof(int), byCost);
+
+	printf("%-10s %8s %10s", "key", "count", "seconds");
+	for (j=0; j<TIME_KINDS; ++j)
+		printf("  %-8s %8s %8s %8s", statTimeNames[j], "p50", "p90",
+			"p99");
+	printf("\n");
+	for (i=0; i<FSTATS_KEYS; ++i) {
+		if (fredStats[keys[i]].count == 0)
+			continue;
+		printf("%-10s %8ld %10.3f", keyName(keys[i]),
+			fredStats[keys[i]].count, totalTime(&fredStats[keys[i]]));
+		for (j=0; j<TIME_KINDS; ++j)
+			printf("  %8.3f %8.3f %8.3f %8.3f",
+				fredStats[keys[i]].total[j],
+				percentile(fredStats[keys[i]].histogram[j], 0.5),
+				percentile(fredStats[keys[i]].histogram[j], 0.9),
+				percentile(fredStats[keys[i]].histogram[j], 0.99));
+		printf("\n");
+	}
 }
@@ -1,13 +1,12 @@
 #include <stdio.h>
+#include "../fstats.h"
 
 main()
 {
 	FILE	*statFyle;
-	int	 i;
 
 	if ((statFyle = fopen("fredStats", "w")) != NULL) {
-		for (i=0; i<128; ++i)
-			putw(0, statFyle);
+		fprintf(statFyle, "%s %d\n", FSTATS_MAGIC, FSTATS_VERSION);
 		fclose(statFyle);
 	} else
 		fprintf(stderr, "couldn't open stat file!\n");
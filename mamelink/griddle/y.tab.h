@@ -133,13 +133,35 @@ extern int yydebug;
 
 /* Value type.  */
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
-typedef int YYSTYPE;
+#line 7 "griddle.y"
+union YYSTYPE
+{
+#line 7 "griddle.y"
+
+	int		 number;
+	char		*string;
+	byte		*bitString;
+	symbol		*name;
+	object		*rawObject;
+	expression	*expr;
+	exprList	*exprs;
+	field		*field;
+	fieldList	*fields;
+	fieldType	 fieldType;
+	objectTail	*tail;
+	property	*property;
+	propertyList	*properties;
+
+#line 156 "y.tab.h"
+
+};
+#line 7 "griddle.y"
+typedef union YYSTYPE YYSTYPE;
 # define YYSTYPE_IS_TRIVIAL 1
 # define YYSTYPE_IS_DECLARED 1
 #endif
 
 
-extern YYSTYPE yylval;
 
 
 int yyparse (void);